@@ -0,0 +1,300 @@
+/*****************************************************************************
+ * CalibrationCodec.cpp -- $Id$
+ *
+ * Purpose
+ *   Implements the CalibrationEncoder and CalibrationDecoder classes.
+ *
+ * Indentation
+ *   Four characters. No tabs!
+ *
+ * Modifications
+ *   2026-10-17 (XSG) Created.
+ *
+ * Copyright (c) 2026 Xiao Shengguang.  All rights reserved.
+ ****************************************************************************/
+
+#include "Common/BaseDefs.h"
+#include <SQLiteCpp/SQLiteCpp.h>
+#include "CalibrationCodec.h"
+
+namespace AOI
+{
+namespace SystemStore
+{
+    namespace
+    {
+        size_t const HEADER_SIZE = 8;
+
+        // Run-length tokens: 0x00-0x7F is a literal of 1-128 bytes that
+        // follow, 0x80-0xFF is a run of 1-128 zero bytes.
+        size_t const MAX_RUN      = 128;
+        Byte   const ZERO_RUN     = 0x80;
+
+        // A literal only ends before this many zeros in a row. Shorter runs
+        // save little space and every token costs a branch when decoding.
+        size_t const MIN_ZERO_RUN = 8;
+
+        bool IsZeroRun(Byte const *source, Byte const *end)
+        {
+            if (static_cast<size_t>(end - source) < MIN_ZERO_RUN)
+                return false;
+            for (size_t i = 0; i < MIN_ZERO_RUN; ++i)
+                if (source[i] != 0)
+                    return false;
+            return true;
+        }
+
+        void PutUInt32(Byte *target, size_t value)
+        {
+            for (int i = 0; i < 4; ++i)
+                target[i] = static_cast<Byte>(value >> (8 * i));
+        }
+
+        size_t GetUInt32(Byte const *source)
+        {
+            size_t value = 0;
+            for (int i = 0; i < 4; ++i)
+                value |= static_cast<size_t>(source[i]) << (8 * i);
+            return value;
+        }
+
+        // Returns the end of the coded bytes. The target must have room for
+        // size + size / MAX_RUN + 1 bytes.
+        Byte *EncodeRuns(Byte const *source, size_t size, Byte *target)
+        {
+            Byte const *end = source + size;
+            while (source < end)
+            {
+                size_t run = 1;
+                if (*source == 0)
+                {
+                    while (run < MAX_RUN && source + run < end && source[run] == 0)
+                        ++run;
+                    *target++ = static_cast<Byte>(ZERO_RUN + run - 1);
+                }
+                else
+                {
+                    while (run < MAX_RUN && source + run < end && !IsZeroRun(source + run, end))
+                        ++run;
+                    *target++ = static_cast<Byte>(run - 1);
+                    memcpy(target, source, run);
+                    target += run;
+                }
+                source += run;
+            }
+            return target;
+        }
+
+        void DecodeRuns(Byte const *source, size_t size, Byte *target, size_t targetSize)
+        {
+            Byte const *end       = source + size;
+            Byte       *targetEnd = target + targetSize;
+            while (source < end)
+            {
+                Byte const token = *source++;
+                if (token >= ZERO_RUN)
+                {
+                    size_t const run = token - ZERO_RUN + 1;
+                    if (static_cast<size_t>(targetEnd - target) < run)
+                        throw SQLite::Exception("Corrupt calibration data.");
+                    memset(target, 0, run);
+                    target += run;
+                }
+                else
+                {
+                    size_t const run = token + 1;
+                    if (static_cast<size_t>(end - source) < run || static_cast<size_t>(targetEnd - target) < run)
+                        throw SQLite::Exception("Corrupt calibration data.");
+                    memcpy(target, source, run);
+                    target += run;
+                    source += run;
+                }
+            }
+            if (target != targetEnd)
+                throw SQLite::Exception("Corrupt calibration data.");
+        }
+
+        // The element loops are instantiated per element size, so that the
+        // byte loops unroll; U is the unsigned integer of that size.
+        template <class U> void Shuffle(Byte const *elements, size_t count, unsigned __int64 &previous, Byte *planes)
+        {
+            U last = static_cast<U>(previous);
+            for (size_t i = 0; i < count; ++i)
+            {
+                U bits;
+                memcpy(&bits, elements + i * sizeof(U), sizeof(U));
+                U const delta = bits ^ last;
+                last = bits;
+
+                for (size_t b = 0; b < sizeof(U); ++b)
+                    planes[b * count + i] = static_cast<Byte>(delta >> (8 * b));
+            }
+            previous = last;
+        }
+
+        // Gathers the planes back into elements first and undoes the XOR in
+        // a second pass, so that the first loop has no dependency between
+        // elements and can be vectorized.
+        template <class U> void Unshuffle(Byte const *planes, size_t count, unsigned __int64 &previous, Byte *elements)
+        {
+            Byte const *plane[sizeof(U)];
+            for (size_t b = 0; b < sizeof(U); ++b)
+                plane[b] = planes + b * count;
+
+            U *target = reinterpret_cast<U *>(elements);
+            for (size_t i = 0; i < count; ++i)
+            {
+                U delta = 0;
+                for (size_t b = 0; b < sizeof(U); ++b)
+                    delta |= static_cast<U>(plane[b][i]) << (8 * b);
+                target[i] = delta;
+            }
+
+            U last = static_cast<U>(previous);
+            for (size_t i = 0; i < count; ++i)
+                target[i] = last ^= target[i];
+            previous = last;
+        }
+    }
+
+    /************************************
+    * CalibrationEncoder implementation *
+    ************************************/
+    CalibrationEncoder::CalibrationEncoder(size_t elementSize, Binary &output)
+      : elementSize(elementSize), output(output), previous(0)
+    {
+        assert((elementSize == 4 || elementSize == 8) && "Element size must be 4 or 8 in CalibrationEncoder.");
+    }
+
+    void CalibrationEncoder::Write(void const *elements, size_t count)
+    {
+        Byte const  *source     = static_cast<Byte const *>(elements);
+        size_t const chunkBytes = CALIBRATION_CHUNK_SIZE * this->elementSize;
+
+        // Top up a partial chunk from an earlier call first.
+        if (!this->pending.empty())
+        {
+            size_t const n = std::min(count, (chunkBytes - this->pending.size()) / this->elementSize);
+            this->pending.insert(this->pending.end(), source, source + n * this->elementSize);
+            source += n * this->elementSize;
+            count  -= n;
+            if (this->pending.size() < chunkBytes)
+                return;
+
+            EncodeChunk(this->pending.data(), CALIBRATION_CHUNK_SIZE);
+            this->pending.clear();
+        }
+
+        // Whole chunks are coded straight from the caller's array.
+        for (; count >= CALIBRATION_CHUNK_SIZE; count -= CALIBRATION_CHUNK_SIZE, source += chunkBytes)
+            EncodeChunk(source, CALIBRATION_CHUNK_SIZE);
+
+        this->pending.assign(source, source + count * this->elementSize);
+    }
+
+    void CalibrationEncoder::Finish()
+    {
+        if (this->pending.empty())
+            return;
+
+        EncodeChunk(this->pending.data(), this->pending.size() / this->elementSize);
+        this->pending.clear();
+    }
+
+    void CalibrationEncoder::EncodeChunk(Byte const *elements, size_t count)
+    {
+        size_t const size = count * this->elementSize;
+        this->planes.resize(size);
+
+        Byte *planes = this->planes.data();
+        if (this->elementSize == 4)
+            Shuffle<unsigned __int32>(elements, count, this->previous, planes);
+        else
+            Shuffle<unsigned __int64>(elements, count, this->previous, planes);
+
+        // Sized for the worst case and trimmed after coding.
+        size_t const header = this->output.size();
+        this->output.resize(header + HEADER_SIZE + size + size / MAX_RUN + 1);
+        Byte *payload = this->output.data() + header + HEADER_SIZE;
+        Byte *end     = EncodeRuns(planes, size, payload);
+        this->output.resize(end - this->output.data());
+
+        PutUInt32(this->output.data() + header,     count);
+        PutUInt32(this->output.data() + header + 4, end - payload);
+    }
+
+    /************************************
+    * CalibrationDecoder implementation *
+    ************************************/
+    CalibrationDecoder::CalibrationDecoder(size_t elementSize, void const *data, size_t size)
+      : elementSize(elementSize), data(static_cast<Byte const *>(data)), end(static_cast<Byte const *>(data) + size), chunkOffset(0), previous(0)
+    {
+        assert((elementSize == 4 || elementSize == 8) && "Element size must be 4 or 8 in CalibrationDecoder.");
+    }
+
+    size_t CalibrationDecoder::Read(void *elements, size_t count)
+    {
+        Byte  *target = static_cast<Byte *>(elements);
+        size_t done   = 0;
+        while (done < count)
+        {
+            // Elements left over from the last chunk come first.
+            size_t const buffered = this->chunk.size() / this->elementSize - this->chunkOffset;
+            if (buffered > 0)
+            {
+                size_t const n = std::min(buffered, count - done);
+                memcpy(target + done * this->elementSize, this->chunk.data() + this->chunkOffset * this->elementSize, n * this->elementSize);
+                this->chunkOffset += n;
+                done += n;
+                continue;
+            }
+
+            size_t const n = NextChunk();
+            if (n == 0)
+                break;
+
+            // A chunk that fits is decoded straight into the caller's array.
+            if (count - done >= n)
+            {
+                DecodeChunk(target + done * this->elementSize, n);
+                done += n;
+            }
+            else
+            {
+                this->chunk.resize(n * this->elementSize);
+                this->chunkOffset = 0;
+                DecodeChunk(this->chunk.data(), n);
+            }
+        }
+        return done;
+    }
+
+    size_t CalibrationDecoder::NextChunk()
+    {
+        if (this->data == this->end)
+            return 0;
+
+        if (static_cast<size_t>(this->end - this->data) < HEADER_SIZE)
+            throw SQLite::Exception("Corrupt calibration data.");
+
+        size_t const count = GetUInt32(this->data);
+        size_t const size  = GetUInt32(this->data + 4);
+        this->data += HEADER_SIZE;
+        if (count == 0 || count > CALIBRATION_CHUNK_SIZE || static_cast<size_t>(this->end - this->data) < size)
+            throw SQLite::Exception("Corrupt calibration data.");
+
+        this->planes.resize(count * this->elementSize);
+        DecodeRuns(this->data, size, this->planes.data(), this->planes.size());
+        this->data += size;
+        return count;
+    }
+
+    void CalibrationDecoder::DecodeChunk(Byte *elements, size_t count)
+    {
+        if (this->elementSize == 4)
+            Unshuffle<unsigned __int32>(this->planes.data(), count, this->previous, elements);
+        else
+            Unshuffle<unsigned __int64>(this->planes.data(), count, this->previous, elements);
+    }
+}
+}
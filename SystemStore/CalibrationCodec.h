@@ -0,0 +1,83 @@
+#ifndef AOI_SYSTEMSTORE_CALIBRATION_CODEC_H
+#define AOI_SYSTEMSTORE_CALIBRATION_CODEC_H
+/*****************************************************************************
+ * CalibrationCodec.h -- $Id$
+ *
+ * Purpose
+ *   Declares the CalibrationEncoder and CalibrationDecoder classes, which
+ *   compress arrays of floating point numbers.
+ *
+ * Indentation
+ *   Four characters. No tabs!
+ *
+ * Modifications
+ *   2026-10-17 (XSG) Created.
+ *
+ * Copyright (c) 2026 Xiao Shengguang.  All rights reserved.
+ ****************************************************************************/
+
+#include "Common/BaseDefs.h"
+
+namespace AOI
+{
+namespace SystemStore
+{
+    // The elements are coded in chunks of CALIBRATION_CHUNK_SIZE. Each
+    // element is XOR-ed with the one before it, which zeroes the sign,
+    // exponent and high mantissa bytes of neighbours in a smooth calibration
+    // map. The chunk is then byte-shuffled, byte k of every element into
+    // plane k, so that those zeros form long runs, and the runs are
+    // run-length coded.
+    //
+    // A chunk is stored as its element count and payload size (32 bits
+    // each, little-endian) followed by the payload. Memory use is bounded
+    // by one chunk, so neither side needs a second full copy of the array.
+    size_t const CALIBRATION_CHUNK_SIZE = 4096;
+
+    class CalibrationEncoder: private Uncopyable
+    {
+    public:
+        // Appends to output. elementSize is 4 (float) or 8 (double).
+        CalibrationEncoder(size_t elementSize, Binary &output);
+
+        // May be called any number of times.
+        void Write(void const *elements, size_t count);
+        // Codes the buffered elements of the last, partial chunk.
+        void Finish();
+
+    private:
+        void EncodeChunk(Byte const *elements, size_t count);
+
+        size_t const       elementSize;
+        Binary            &output;
+        Binary             pending;     // elements of a partial chunk
+        Binary             planes;
+        unsigned __int64   previous;
+    };
+
+    class CalibrationDecoder: private Uncopyable
+    {
+    public:
+        // The data must stay valid while the decoder is used.
+        CalibrationDecoder(size_t elementSize, void const *data, size_t size);
+
+        // Decodes up to count elements and returns the number decoded,
+        // which is less than count only at the end of the data. Throws if
+        // the data is corrupt.
+        size_t Read(void *elements, size_t count);
+
+    private:
+        size_t NextChunk();
+        void   DecodeChunk(Byte *elements, size_t count);
+
+        size_t const       elementSize;
+        Byte const        *data;
+        Byte const        *end;
+        Binary             planes;
+        Binary             chunk;       // decoded elements not yet read
+        size_t             chunkOffset;
+        unsigned __int64   previous;
+    };
+}
+}
+#endif/*AOI_SYSTEMSTORE_CALIBRATION_CODEC_H*/
@@ -0,0 +1,129 @@
+/*****************************************************************************
+ * CalibrationTable.cpp -- $Id$
+ *
+ * Purpose
+ *   Implements the CalibrationTable class.
+ *
+ * Indentation
+ *   Four characters. No tabs!
+ *
+ * Modifications
+ *   2026-10-17 (XSG) Moved the field table to the header.
+ *   2026-10-17 (XSG) Kept the insert statement after a failed insert.
+ *   2026-10-17 (XSG) Created.
+ *
+ * Copyright (c) 2026 Xiao Shengguang.  All rights reserved.
+ ****************************************************************************/
+
+#include "Common/BaseDefs.h"
+#include "CalibrationTable.h"
+
+namespace AOI
+{
+namespace SystemStore
+{
+    /***********************
+    * Table implementation *
+    ***********************/
+    String CalibrationTable::GetConstraintSql(int index) const
+    {
+        assert(index >= 0 && index < GetConstraintCount() && "Constraint index out of range in CalibrationTable::GetConstraintSql.");
+
+        // Also the index that finds the versions of a calibration.
+        return (boost::format(SL("unique (%s, %s)")) % GetFieldName(NAME) % GetFieldName(VERSION)).str();
+    }
+
+    /**********************************
+    * CalibrationTable implementation *
+    **********************************/
+
+    /*static*/String CalibrationTable::StaticGetTableName()
+    {
+        return SL("calibration");
+    }
+
+    Int64 CalibrationTable::Insert(String const &name, Int64 version, Int64 time, Enum::ElementType elementType, Int64 elementCount, Binary const &data)
+    {
+        try
+        {
+            if (!this->insert)
+            {
+                int const fi[] = { NAME, VERSION, TIME, ELEMENT_TYPE, ELEMENT_COUNT, DATA };
+                this->insert = BuildInsertCommand(fi, fi + sizeof(fi) / sizeof(fi[0]));
+            }
+
+            int i = 0;
+            Bind(this->insert, ++i, name);
+            Bind(this->insert, ++i, version);
+            Bind(this->insert, ++i, time);
+            Bind(this->insert, ++i, ToInt32(elementType));
+            Bind(this->insert, ++i, elementCount);
+            BindNoCopy(this->insert, ++i, data);
+            Exec(this->insert);
+
+            return GetLastInsertedRowId();
+        }
+        catch (...)
+        {
+            if (this->insert)
+                ResetAfterError(this->insert);
+            throw;
+        }
+    }
+
+    Int64 CalibrationTable::SelectLatestVersion(String const &name) const
+    {
+        if (!this->selectLatestVersion)
+        {
+            String const fmt = SL("select coalesce(max(%1%), 0) from %2% where %3% = ?;");
+            String const sql = (boost::format(fmt) % GetFieldName(VERSION) % GetTableName() % GetFieldName(NAME)).str();
+            this->selectLatestVersion = Prepare(sql);
+        }
+
+        Int64 version = 0;
+        Bind(this->selectLatestVersion, 1, name);
+        Exec(this->selectLatestVersion, version);
+        return version;
+    }
+
+    bool CalibrationTable::SelectData(String const &name, Int64 version, DataVisitor const &visitor) const
+    {
+        StatementPtr &select = (version == 0) ? this->selectLatestData : this->selectData;
+        try
+        {
+            if (!select)
+            {
+                String const fmt = (version == 0)
+                                 ? SL("select %1%, %2%, %3%, %4% from %5% where %6% = ? order by %1% desc limit 1;")
+                                 : SL("select %1%, %2%, %3%, %4% from %5% where %6% = ? and %1% = ?;");
+                String const sql = (boost::format(fmt) % GetFieldName(VERSION) % GetFieldName(ELEMENT_TYPE) % GetFieldName(ELEMENT_COUNT)
+                    % GetFieldName(DATA) % GetTableName() % GetFieldName(NAME)).str();
+                select = Prepare(sql);
+            }
+
+            Bind(select, 1, name);
+            if (version != 0)
+                Bind(select, 2, version);
+
+            bool const found = select->executeStep();
+            if (found)
+            {
+                // The data is read in place, the reset below frees it.
+                SQLite::Column data = select->getColumn(3);
+                void const  *bytes  = data.getBlob();
+                size_t const size   = static_cast<size_t>(data.getBytes());
+                visitor(select->getColumn(0).getInt64(), static_cast<Enum::ElementType>(select->getColumn(1).getInt()),
+                    select->getColumn(2).getInt64(), bytes, size);
+            }
+            select->reset();
+            return found;
+        }
+        catch (...)
+        {
+            if (select)
+                select->reset();
+            throw;
+        }
+    }
+}
+}
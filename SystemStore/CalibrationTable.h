@@ -0,0 +1,104 @@
+#ifndef AOI_SYSTEMSTORE_CALIBRATION_TABLE_H
+#define AOI_SYSTEMSTORE_CALIBRATION_TABLE_H
+/*****************************************************************************
+ * CalibrationTable.h -- $Id$
+ *
+ * Purpose
+ *   Declares the CalibrationTable class, which holds versioned calibration
+ *   results as compressed arrays.
+ *
+ * Indentation
+ *   Four characters. No tabs!
+ *
+ * Modifications
+ *   2026-10-17 (XSG) Described the fields inline through StaticTable.
+ *   2026-10-17 (XSG) Created.
+ *
+ * Copyright (c) 2026 Xiao Shengguang.  All rights reserved.
+ ****************************************************************************/
+
+#include "IdBasedTable.h"
+#include "StaticTable.h"
+
+namespace AOI
+{
+namespace SystemStore
+{
+    class CalibrationTable;
+
+    using CalibrationTablePtr = std::shared_ptr<CalibrationTable>;
+
+    class CalibrationTable: public StaticTable<CalibrationTable, IdBasedTable>
+    {
+    public:
+        explicit CalibrationTable(DatabasePtr const &database): StaticTable(database) {}
+        virtual ~CalibrationTable() {}
+
+        enum FieldIndex
+        {
+            ID,
+            NAME,
+            VERSION,
+            TIME,
+            ELEMENT_TYPE,
+            ELEMENT_COUNT,
+            DATA,
+            COUNT_,
+        };
+
+        /********
+        * Table *
+        ********/
+        virtual String GetTableName()    const override { return StaticGetTableName(); }
+
+        virtual int    GetConstraintCount()   const override { return 1; }
+        virtual String GetConstraintSql (int) const override;
+
+        /***************
+        * IdBasedTable *
+        ***************/
+        virtual int GetFieldIndexOfId() const { return ID; }
+
+        /*******************
+        * CalibrationTable *
+        *******************/
+        static String StaticGetTableName();
+        // The layout, see StaticTable.
+        static FieldEntry const &StaticGetField(int index)
+        {
+            static FieldEntry const fields[] =
+            {
+                { SL("id"),           BIT_INTID | BIT_PKEYINC, SL("") },
+                { SL("name"),         BIT_NCSTR,               SL("") },
+                { SL("version"),      BIT_INT64,               SL("") },
+                { SL("time"),         BIT_INT64,               SL("") },
+                { SL("elementType"),  BIT_INT32,               SL("") },
+                { SL("elementCount"), BIT_INT64,               SL("") },
+                { SL("data"),         BIT_BLOB,                SL("") },
+            };
+
+            BOOST_STATIC_ASSERT(sizeof(fields) / sizeof(fields[0]) == COUNT_);
+            return fields[index];
+        }
+
+        // The data is the coded array (see CalibrationCodec.h).
+        Int64 Insert(String const &name, Int64 version, Int64 time, Enum::ElementType, Int64 elementCount, Binary const &data);
+
+        // The latest version of the calibration, 0 if there is none.
+        Int64 SelectLatestVersion(String const &name) const;
+
+        // Hands the visitor the record and SQLite's buffer of its data,
+        // which is only valid during the call. Version 0 selects the latest
+        // version. Returns false if there is no such record.
+        typedef std::function<void(Int64 version, Enum::ElementType, Int64 elementCount, void const *data, size_t size)> DataVisitor;
+        bool SelectData(String const &name, Int64 version, DataVisitor const &) const;
+
+    private:
+        StatementPtr         insert;
+        StatementPtr mutable selectLatestVersion;
+        StatementPtr mutable selectData;
+        StatementPtr mutable selectLatestData;
+    };
+}
+}
+#endif/*AOI_SYSTEMSTORE_CALIBRATION_TABLE_H*/
@@ -8,6 +8,13 @@ namespace SystemStore
 
 #define SYSTEM_DB_NAME      "system.cfg"
 #define ENCRYPT_KEY         "ABCDEFGH12346789"
+#define CIPHER_BLOCK_SIZE   (16)
+#define PARAM_HISTORY_CAPACITY  (10000)
+#define SESSION_TIMEOUT_MS      (30 * 60 * 1000)
+#define PARALLEL_ENCRYPT_COUNT  (4096)
+#define USER_PAGE_SIZE          (256)
+#define STATEMENT_CACHE_CAPACITY (64)
+#define INSERT_BATCH_VARIABLES  (999)
 
 namespace Enum
 {
@@ -20,6 +27,27 @@ namespace Enum
         MAX_ = YES,
         END_,
     };
+
+    enum class ParamType
+    {
+        UNDEFINED,
+        INT,
+        REAL,
+        BLOB,
+        MIN_ = UNDEFINED,
+        MAX_ = BLOB,
+        END_,
+    };
+
+    enum class ElementType
+    {
+        UNDEFINED,
+        FLOAT32,
+        FLOAT64,
+        MIN_ = UNDEFINED,
+        MAX_ = FLOAT64,
+        END_,
+    };
 }
 
 }
@@ -8,6 +8,7 @@
  *   Four characters. No tabs!
  *
  * Modifications
+ *   2026-10-17 (XSG) Added a row select for several fields.
  *   2012-03-26 (MM) Added a copy method.
  *   2012-03-02 (MM) Changed to a new storage organization.
  *   2010-12-11 (MM) Changed to new bind scheme.
@@ -65,7 +66,7 @@ namespace SystemStore
                 }
 
             String const sql = sql1 + sql2 + SL(" from ") + tn + SL(" where ") + GetFieldName(idfi) + SL(" = ?;");
-            this->copcmd = std::make_shared<SQLite::Statement>( *GetDatabase().get(), sql );
+            this->copcmd = Prepare(sql);
         }
 
         Bind(this->copcmd, 1, id, ID_SAFE);
@@ -135,6 +136,27 @@ namespace SystemStore
         value = Enum::YesNo(v);
     }
 
+    bool IdBasedTable::SelectRow(Int64 id, StatementPtr &select, int const *valueFieldIndexBegin, int const *valueFieldIndexEnd, RowVisitor const &visitor) const
+    {
+        if (!select)
+            select = BuildSelectQueryWithId(valueFieldIndexBegin, valueFieldIndexEnd);
+
+        try
+        {
+            Bind(select, 1, id, ID_SAFE);
+            bool const found = select->executeStep();
+            if (found)
+                visitor(*select);
+            select->reset();
+            return found;
+        }
+        catch (...)
+        {
+            select->reset();
+            throw;
+        }
+    }
+
     void IdBasedTable::Update(Int64 id, StatementPtr &update, int fieldIndex, Int32 value)
     {
         if (!update)
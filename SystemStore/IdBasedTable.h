@@ -10,6 +10,7 @@
  *   Four characters. No tabs!
  *
  * Modifications
+ *   2026-10-17 (XSG) Added a row select for several fields.
  *   2012-03-26 (MM) Added a copy method.
  *   2012-03-02 (MM) Changed to a new storage organization.
  *   2010-12-10 (MM) Added generic Select/Update methods.
@@ -71,6 +72,13 @@ namespace SystemStore
 
         void Select(Int64 id, StatementPtr &select, int fieldIndex, Enum::YesNo &) const;
 
+        // Selects several fields of the row with the id in one query and
+        // hands the visitor the statement, whose columns follow the field
+        // indexes and are only valid during the call. Returns false if
+        // there is no such row.
+        typedef std::function<void(SQLite::Statement &)> RowVisitor;
+        bool SelectRow(Int64 id, StatementPtr &select, int const *valueFieldIndexBegin, int const *valueFieldIndexEnd, RowVisitor const &) const;
+
         void Update(Int64 id, StatementPtr &update, int fieldIndex, Int32);
         void Update(Int64 id, StatementPtr &update, int fieldIndex, Int64);
         void Update(Int64 id, StatementPtr &update, int fieldIndex, double);
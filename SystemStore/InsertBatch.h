@@ -0,0 +1,239 @@
+#ifndef AOI_SYSTEMSTORE_INSERT_BATCH_H
+#define AOI_SYSTEMSTORE_INSERT_BATCH_H
+/*****************************************************************************
+ * InsertBatch.h -- $Id$
+ *
+ * Purpose
+ *   Declares and implements the InsertBatch class template, which inserts
+ *   rows into a table with multi-row insert statements.
+ *
+ * Indentation
+ *   Four characters. No tabs!
+ *
+ * Modifications
+ *   2026-10-17 (XSG) Made a template on the table, for its static binders.
+ *   2026-10-17 (XSG) Created.
+ *
+ * Copyright (c) 2026 Xiao Shengguang.  All rights reserved.
+ ****************************************************************************/
+
+#include "Table.h"
+#include "Constants.h"
+#include <SQLite3/sqlite3.h>
+
+namespace AOI
+{
+namespace SystemStore
+{
+    // The rows are kept until a batch is full, then inserted with one
+    // statement of the form "insert into <table> (...) values (...), (...),
+    // ...;", which runs the insert once for all of them. A batch binds at
+    // most INSERT_BATCH_VARIABLES values, SQLite's default limit, so its
+    // rows are fewer for a table with many fields. Values are added in field
+    // order and a row is complete when every field has a value.
+    //
+    // TableT is the class of the table, so that the binders are resolved at
+    // compile time, e.g. the Int64 one of a StaticTable.
+    template <class TableT>
+    class InsertBatch: private Uncopyable
+    {
+    public:
+        InsertBatch(TableT const &table, int const *fieldIndexBegin, int const *fieldIndexEnd);
+
+        // The rows of a full batch.
+        size_t GetBatchRows() const { return this->batchRows; }
+
+        // Int64 values are bound as by Table::Bind with a field index, so
+        // ID_NULL is null in an id field.
+        void Add(Int32         value);
+        void Add(Int64         value);
+        void Add(double        value);
+        void Add(String const &value);
+        void Add(Binary const &value);
+
+        // One row, a value per field.
+        template <class... T> void AddRow(T const &... values)
+        {
+            assert(sizeof...(values) == this->fields.size() && "Value count differs from the field count in InsertBatch::AddRow.");
+            int const added[] = { (Add(values), 0)... };
+            (void)added;
+        }
+
+        // Row-major: rowCount rows of values of one type, the fields of
+        // the first row, then those of the second, and so on.
+        template <class T> void AddRows(T const *values, size_t rowCount)
+        {
+            for (size_t i = 0, n = rowCount * this->fields.size(); i != n; ++i)
+                Add(values[i]);
+        }
+
+        // Column-major: an array of rowCount values per field.
+        template <class... T> void AddColumns(size_t rowCount, T const *... columns)
+        {
+            for (size_t i = 0; i != rowCount; ++i)
+                AddRow(columns[i]...);
+        }
+
+        // Inserts the rows added since the last insert, it is called when a
+        // batch is full. The rows of a batch that fails are not inserted,
+        // they are dropped, and the batch starts again empty.
+        void Flush();
+
+        // The rows inserted so far. For an IdBasedTable whose id is not one
+        // of the fields, the ids SQLite gave them are first to last, with
+        // no gaps if nothing else was inserted into the table in between.
+        Int64 GetRowCount() const { return this->rowCount; }
+        Int64 GetFirstId () const { return this->firstId; }
+        Int64 GetLastId  () const { return this->lastId; }
+
+    private:
+        enum ValueType
+        {
+            INT32,
+            INT64,
+            REAL,
+            TEXT,
+            BLOB,
+        };
+
+        struct Value
+        {
+            ValueType type;
+            Int64     intValue;
+            double    realValue;
+            String    text;
+            Binary    blob;
+        };
+
+        Value &Next(ValueType type);
+        void   Added();
+
+        TableT const       &table;
+        std::vector<int>    fields;
+        size_t              batchRows;
+        std::vector<Value>  values;     // of a full batch, reused
+        size_t              count;      // values added since the last insert
+        StatementPtr        insert;     // of a full batch
+        Int64               rowCount;
+        Int64               firstId;
+        Int64               lastId;
+    };
+
+    template <class TableT>
+    InsertBatch<TableT>::InsertBatch(TableT const &table, int const *fieldIndexBegin, int const *fieldIndexEnd)
+      : table(table), fields(fieldIndexBegin, fieldIndexEnd), count(0), rowCount(0), firstId(Table::ID_NULL), lastId(Table::ID_NULL)
+    {
+        assert(fieldIndexBegin != fieldIndexEnd && "Invalid field index iterators in InsertBatch::InsertBatch.");
+
+        // A connection may have been opened with a lower limit.
+        int const limit = std::min(INSERT_BATCH_VARIABLES, sqlite3_limit(table.GetDatabase()->getHandle(), SQLITE_LIMIT_VARIABLE_NUMBER, -1));
+        this->batchRows = std::max<size_t>(1, limit / this->fields.size());
+        this->values.resize(this->batchRows * this->fields.size());
+    }
+
+    template <class TableT>
+    typename InsertBatch<TableT>::Value &InsertBatch<TableT>::Next(ValueType type)
+    {
+        Value &value = this->values[this->count];
+        value.type = type;
+        return value;
+    }
+
+    template <class TableT>
+    void InsertBatch<TableT>::Added()
+    {
+        if (++this->count == this->values.size())
+            Flush();
+    }
+
+    template <class TableT>
+    void InsertBatch<TableT>::Add(Int32 value)
+    {
+        Next(INT32).intValue = value;
+        Added();
+    }
+
+    template <class TableT>
+    void InsertBatch<TableT>::Add(Int64 value)
+    {
+        Next(INT64).intValue = value;
+        Added();
+    }
+
+    template <class TableT>
+    void InsertBatch<TableT>::Add(double value)
+    {
+        Next(REAL).realValue = value;
+        Added();
+    }
+
+    template <class TableT>
+    void InsertBatch<TableT>::Add(String const &value)
+    {
+        // Assigned, so the capacity of the slot is reused.
+        Next(TEXT).text = value;
+        Added();
+    }
+
+    template <class TableT>
+    void InsertBatch<TableT>::Add(Binary const &value)
+    {
+        Next(BLOB).blob = value;
+        Added();
+    }
+
+    template <class TableT>
+    void InsertBatch<TableT>::Flush()
+    {
+        size_t const fieldCount = this->fields.size();
+        assert(this->count % fieldCount == 0 && "Partial row in InsertBatch::Flush.");
+
+        size_t const rows = this->count / fieldCount;
+        if (rows == 0)
+            return;
+        this->count = 0;
+
+        // A short last batch has a statement of its own, from the cache.
+        StatementPtr insert = (rows == this->batchRows) ? this->insert : StatementPtr();
+        try
+        {
+            if (!insert)
+            {
+                insert = this->table.BuildInsertCommand(&this->fields[0], &this->fields[0] + fieldCount, static_cast<int>(rows));
+                if (rows == this->batchRows)
+                    this->insert = insert;
+            }
+
+            for (size_t i = 0, n = rows * fieldCount; i != n; ++i)
+            {
+                Value const &value = this->values[i];
+                Int32 const  index = static_cast<Int32>(i + 1);
+                switch (value.type)
+                {
+                case INT32: this->table.Bind(insert, index, static_cast<Int32>(value.intValue)); break;
+                case INT64: this->table.Bind(insert, index, value.intValue, this->fields[i % fieldCount]); break;
+                case REAL:  this->table.Bind(insert, index, value.realValue); break;
+                case TEXT:  this->table.Bind(insert, index, value.text); break;
+                case BLOB:  this->table.BindNoCopy(insert, index, value.blob); break;
+                }
+            }
+            this->table.Exec(insert);
+        }
+        catch (...)
+        {
+            if (insert)
+                this->table.ResetAfterError(insert);
+            throw;
+        }
+
+        // SQLite numbers the rows of one insert one after the other, the
+        // last inserted row id is that of the last row.
+        Int64 const lastId = this->table.GetLastInsertedRowId();
+        if (this->rowCount == 0)
+            this->firstId = lastId - static_cast<Int64>(rows) + 1;
+        this->lastId    = lastId;
+        this->rowCount += static_cast<Int64>(rows);
+    }
+}
+}
+#endif/*AOI_SYSTEMSTORE_INSERT_BATCH_H*/
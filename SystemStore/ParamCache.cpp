@@ -0,0 +1,172 @@
+/*****************************************************************************
+ * ParamCache.cpp -- $Id$
+ *
+ * Purpose
+ *   Implements the ParamCache class.
+ *
+ * Indentation
+ *   Four characters. No tabs!
+ *
+ * Modifications
+ *   2026-10-17 (XSG) Created.
+ *
+ * Copyright (c) 2026 Xiao Shengguang.  All rights reserved.
+ ****************************************************************************/
+
+#include "Common/BaseDefs.h"
+#include "ParamCache.h"
+
+namespace AOI
+{
+namespace SystemStore
+{
+    namespace
+    {
+        size_t const MIN_CAPACITY = 16;     // Must be a power of two.
+        size_t const NOT_FOUND    = size_t(-1);
+
+        // The table is grown when live and erased slots exceed 7/10 of it.
+        bool IsOverloaded(size_t used, size_t capacity)
+        {
+            return used * 10 > capacity * 7;
+        }
+    }
+
+    ParamCache::ParamCache()
+      : count(0), erased(0)
+    {
+    }
+
+    void ParamCache::Reserve(size_t count)
+    {
+        size_t capacity = MIN_CAPACITY;
+        while (IsOverloaded(count, capacity))
+            capacity <<= 1;
+
+        if (capacity > this->slots.size())
+            Rehash(capacity);
+    }
+
+    void ParamCache::Clear()
+    {
+        this->slots.clear();
+        this->arena.clear();
+        this->count  = 0;
+        this->erased = 0;
+    }
+
+    ParamValue const *ParamCache::Find(char const *name, size_t length) const
+    {
+        if (this->count == 0)
+            return nullptr;
+
+        size_t const index = Probe(name, length, Hash(name, length));
+        return (index == NOT_FOUND) ? nullptr : &this->slots[index].value;
+    }
+
+    void ParamCache::Insert(char const *name, size_t length, ParamValue const &value)
+    {
+        size_t const hash = Hash(name, length);
+
+        size_t index = (this->count == 0) ? NOT_FOUND : Probe(name, length, hash);
+        if (index != NOT_FOUND)
+        {
+            this->slots[index].value = value;
+            return;
+        }
+
+        if (this->slots.empty() || IsOverloaded(this->count + this->erased + 1, this->slots.size()))
+        {
+            // Grow only if the live slots need it; otherwise the rehash just
+            // drops the tombstones and the names they left in the arena.
+            size_t capacity = std::max(this->slots.size(), MIN_CAPACITY);
+            while (IsOverloaded(this->count + 1, capacity))
+                capacity <<= 1;
+            Rehash(capacity);
+        }
+
+        size_t const mask = this->slots.size() - 1;
+        for (index = hash & mask; this->slots[index].state == FULL; index = (index + 1) & mask)
+            ;
+
+        Slot &slot = this->slots[index];
+        if (slot.state == ERASED)
+            -- this->erased;
+
+        slot.hash   = hash;
+        slot.offset = this->arena.size();
+        slot.length = length;
+        slot.state  = FULL;
+        slot.value  = value;
+        this->arena.insert(this->arena.end(), name, name + length);
+        ++ this->count;
+    }
+
+    void ParamCache::Erase(String const &name)
+    {
+        if (this->count == 0)
+            return;
+
+        size_t const index = Probe(name.data(), name.size(), Hash(name.data(), name.size()));
+        if (index == NOT_FOUND)
+            return;
+
+        this->slots[index].state = ERASED;
+        -- this->count;
+        ++ this->erased;
+    }
+
+    /*static*/size_t ParamCache::Hash(char const *name, size_t length)
+    {
+        // FNV-1a, which is cheap for the short dotted names params have.
+        unsigned long long hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash ^= static_cast<unsigned char>(name[i]);
+            hash *= 1099511628211ULL;
+        }
+        return static_cast<size_t>(hash ^ (hash >> 32));
+    }
+
+    size_t ParamCache::Probe(char const *name, size_t length, size_t hash) const
+    {
+        size_t const mask = this->slots.size() - 1;
+        for (size_t index = hash & mask; ; index = (index + 1) & mask)
+        {
+            Slot const &slot = this->slots[index];
+            if (slot.state == EMPTY)
+                return NOT_FOUND;
+
+            if (slot.state == FULL && slot.hash == hash && slot.length == length
+                && std::equal(name, name + length, this->arena.begin() + slot.offset))
+                return index;
+        }
+    }
+
+    void ParamCache::Rehash(size_t capacity)
+    {
+        std::vector<Slot> oldSlots(capacity);
+        std::vector<char> oldArena;
+        oldSlots.swap(this->slots);
+        oldArena.swap(this->arena);
+        this->arena.reserve(oldArena.size());
+
+        size_t const mask = capacity - 1;
+        for (auto const &old : oldSlots)
+        {
+            if (old.state != FULL)
+                continue;
+
+            size_t index = old.hash & mask;
+            while (this->slots[index].state == FULL)
+                index = (index + 1) & mask;
+
+            Slot &slot  = this->slots[index];
+            slot        = old;
+            slot.offset = this->arena.size();
+            this->arena.insert(this->arena.end(), oldArena.begin() + old.offset, oldArena.begin() + old.offset + old.length);
+        }
+        this->erased = 0;
+    }
+}
+}
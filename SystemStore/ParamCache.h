@@ -0,0 +1,80 @@
+#ifndef AOI_SYSTEMSTORE_PARAM_CACHE_H
+#define AOI_SYSTEMSTORE_PARAM_CACHE_H
+/*****************************************************************************
+ * ParamCache.h -- $Id$
+ *
+ * Purpose
+ *   Declares the ParamCache class, a flat open-addressing hash table from
+ *   param names to param values.
+ *
+ * Indentation
+ *   Four characters. No tabs!
+ *
+ * Modifications
+ *   2026-10-17 (XSG) Created.
+ *
+ * Copyright (c) 2026 Xiao Shengguang.  All rights reserved.
+ ****************************************************************************/
+
+#include "ParamTable.h"
+
+namespace AOI
+{
+namespace SystemStore
+{
+    // The slots live in one array and the names are packed into one
+    // character arena, so a lookup touches at most a couple of cache lines
+    // and an insert never allocates a node. Collisions are resolved by
+    // linear probing; erased slots are tombstones until the next rehash.
+    class ParamCache: private Uncopyable
+    {
+    public:
+        ParamCache();
+
+        void   Reserve(size_t count);
+        void   Clear();
+        size_t GetCount() const { return this->count; }
+
+        // Returns null if the name is not cached. The pointer is valid
+        // until the cache is next modified.
+        ParamValue const *Find(char const *name, size_t length) const;
+        ParamValue const *Find(String const &name) const { return Find(name.data(), name.size()); }
+
+        // Inserts the name or replaces its value.
+        void Insert(char const *name, size_t length, ParamValue const &value);
+        void Insert(String const &name, ParamValue const &value) { Insert(name.data(), name.size(), value); }
+
+        void Erase(String const &name);
+
+    private:
+        enum SlotState
+        {
+            EMPTY,
+            FULL,
+            ERASED,
+        };
+
+        struct Slot
+        {
+            size_t     hash;
+            size_t     offset;  // of the name in the arena
+            size_t     length;
+            SlotState  state;
+            ParamValue value;
+
+            Slot() : hash(0), offset(0), length(0), state(EMPTY) {}
+        };
+
+        static size_t Hash(char const *name, size_t length);
+
+        size_t Probe (char const *name, size_t length, size_t hash) const;
+        void   Rehash(size_t capacity);
+
+        std::vector<Slot> slots;
+        std::vector<char> arena;
+        size_t            count;
+        size_t            erased;
+    };
+}
+}
+#endif/*AOI_SYSTEMSTORE_PARAM_CACHE_H*/
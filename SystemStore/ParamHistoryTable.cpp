@@ -0,0 +1,154 @@
+/*****************************************************************************
+ * ParamHistoryTable.cpp -- $Id$
+ *
+ * Purpose
+ *   Implements the ParamHistoryTable class.
+ *
+ * Indentation
+ *   Four characters. No tabs!
+ *
+ * Modifications
+ *   2026-10-17 (XSG) Named the param columns through the param field table.
+ *   2026-10-17 (XSG) Moved the field table to the header.
+ *   2026-10-17 (XSG) Kept the insert statement after a failed insert.
+ *   2026-10-17 (XSG) Created.
+ *
+ * Copyright (c) 2026 Xiao Shengguang.  All rights reserved.
+ ****************************************************************************/
+
+#include "Common/BaseDefs.h"
+#include "ParamHistoryTable.h"
+#include "ParamTable.h"
+
+namespace AOI
+{
+namespace SystemStore
+{
+    namespace
+    {
+        void ReadValue(SQLite::Column const &column, bool &hasValue, double &value)
+        {
+            hasValue = !column.isNull();
+            value    = hasValue ? column.getDouble() : 0.;
+        }
+    }
+
+    /***********************************
+    * ParamHistoryTable implementation *
+    ***********************************/
+
+    /*static*/String ParamHistoryTable::StaticGetTableName()
+    {
+        return SL("param_history");
+    }
+
+    void ParamHistoryTable::Index()
+    {
+        // The sequence number breaks ties in the time order of Select.
+        String const fmt = SL("create index %1%_%2%_%3% on %1% (%2%, %3%, %4%);");
+        GetDatabase()->exec((boost::format(fmt) % GetTableName() % GetFieldName(NAME) % GetFieldName(TIME) % GetFieldName(SEQ)).str());
+    }
+
+    Int64 ParamHistoryTable::SelectLastSeq() const
+    {
+        if (!this->selectLastSeq)
+        {
+            // Served by the unique index on seq.
+            String const fmt = SL("select coalesce(max(%1%), 0) from %2%;");
+            String const sql = (boost::format(fmt) % GetFieldName(SEQ) % GetTableName()).str();
+            this->selectLastSeq = Prepare(sql);
+        }
+
+        Int64 seq = 0;
+        Exec(this->selectLastSeq, seq);
+        return seq;
+    }
+
+    template <class T> void ParamHistoryTable::InsertT(Int64 seq, String const &name, Int64 time, String const &userName, T const &newValue)
+    {
+        try
+        {
+            if (!this->insert)
+            {
+                // The old value is read from the param row, and is null if
+                // the param does not exist yet. Blobs are not kept, or a
+                // few calibration changes would fill the file.
+                String const fmt = SL("insert or replace into %1% (%2%, %3%, %4%, %5%, %6%, %7%, %8%) ")
+                                   SL("values (?1 %% %9%, ?1, ?2, ?3, ?4, ")
+                                   SL("(select case when typeof(%11%) = 'blob' then null else %11% end from %10% where %12% = ?3), ?5);");
+                String const sql = (boost::format(fmt) % GetTableName() % GetFieldName(SLOT) % GetFieldName(SEQ)
+                    % GetFieldName(TIME) % GetFieldName(NAME) % GetFieldName(USER_NAME) % GetFieldName(OLD_VALUE) % GetFieldName(NEW_VALUE)
+                    % this->capacity % ParamTable::StaticGetTableName() % ParamTable::StaticGetField(ParamTable::VALUE).fieldName
+                    % ParamTable::StaticGetField(ParamTable::NAME).fieldName).str();
+                this->insert = Prepare(sql);
+            }
+
+            Bind(this->insert, 1, seq);
+            Bind(this->insert, 2, time);
+            Bind(this->insert, 3, name);
+            Bind(this->insert, 4, userName);
+            BindValue(this->insert, 5, newValue);
+            Exec(this->insert);
+        }
+        catch (...)
+        {
+            if (this->insert)
+                ResetAfterError(this->insert);
+            throw;
+        }
+    }
+
+    void ParamHistoryTable::Insert(Int64 seq, String const &name, Int64 time, String const &userName, Int32 newValue)
+    {
+        InsertT(seq, name, time, userName, newValue);
+    }
+
+    void ParamHistoryTable::Insert(Int64 seq, String const &name, Int64 time, String const &userName, double newValue)
+    {
+        InsertT(seq, name, time, userName, newValue);
+    }
+
+    void ParamHistoryTable::Insert(Int64 seq, String const &name, Int64 time, String const &userName, Binary const &newValue)
+    {
+        InsertT(seq, name, time, userName, newValue);
+    }
+
+    void ParamHistoryTable::Select(String const &name, Int64 fromTime, Int64 toTime, std::vector<ParamHistoryRow> &rows) const
+    {
+        if (!this->select)
+        {
+            // The index on (name, time, seq) finds the rows in order, the
+            // user and values are then read from the table rows.
+            String const fmt = SL("select %1%, %2%, %3%, %4%, %5% from %6% where %2% = ? and %1% >= ? and %1% <= ? order by %1%, %7%;");
+            String const sql = (boost::format(fmt) % GetFieldName(TIME) % GetFieldName(NAME) % GetFieldName(USER_NAME)
+                % GetFieldName(OLD_VALUE) % GetFieldName(NEW_VALUE) % GetTableName() % GetFieldName(SEQ)).str();
+            this->select = Prepare(sql);
+        }
+
+        rows.clear();
+        try
+        {
+            int i = 0;
+            Bind(this->select, ++i, name);
+            Bind(this->select, ++i, fromTime);
+            Bind(this->select, ++i, toTime);
+            while (this->select->executeStep())
+            {
+                ParamHistoryRow row;
+                row.time     = this->select->getColumn(0).getInt64();
+                row.name     = this->select->getColumn(1).getString();
+                row.userName = this->select->getColumn(2).getString();
+                ReadValue(this->select->getColumn(3), row.hasOldValue, row.oldValue);
+                ReadValue(this->select->getColumn(4), row.hasNewValue, row.newValue);
+                rows.push_back(row);
+            }
+            this->select->reset();
+        }
+        catch (...)
+        {
+            this->select->reset();
+            throw;
+        }
+    }
+}
+}
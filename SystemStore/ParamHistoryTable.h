@@ -0,0 +1,131 @@
+#ifndef AOI_SYSTEMSTORE_PARAM_HISTORY_TABLE_H
+#define AOI_SYSTEMSTORE_PARAM_HISTORY_TABLE_H
+/*****************************************************************************
+ * ParamHistoryTable.h -- $Id$
+ *
+ * Purpose
+ *   Declares the ParamHistoryTable class, a fixed-capacity log of param
+ *   changes.
+ *
+ * Indentation
+ *   Four characters. No tabs!
+ *
+ * Modifications
+ *   2026-10-17 (XSG) Indexed the name and time in Index, not in Create.
+ *   2026-10-17 (XSG) Described the fields inline through StaticTable.
+ *   2026-10-17 (XSG) Created.
+ *
+ * Copyright (c) 2026 Xiao Shengguang.  All rights reserved.
+ ****************************************************************************/
+
+#include "IdBasedTable.h"
+#include "StaticTable.h"
+
+namespace AOI
+{
+namespace SystemStore
+{
+    class ParamHistoryTable;
+
+    using ParamHistoryTablePtr = std::shared_ptr<ParamHistoryTable>;
+
+    // A row of the history. A missing value is the old value of a param
+    // that was created, or a binary value, which is not kept.
+    struct ParamHistoryRow
+    {
+        Int64  time;
+        String name;
+        String userName;
+        bool   hasOldValue;
+        double oldValue;
+        bool   hasNewValue;
+        double newValue;
+    };
+
+    // The table works as a ring buffer. Every change gets the next sequence
+    // number and is written to slot (sequence % capacity), replacing the
+    // oldest change once the table is full, so the table never grows past
+    // its capacity.
+    class ParamHistoryTable: public StaticTable<ParamHistoryTable, IdBasedTable>
+    {
+    public:
+        ParamHistoryTable(DatabasePtr const &database, Int64 capacity): StaticTable(database), capacity(capacity) {}
+        virtual ~ParamHistoryTable() {}
+
+        enum FieldIndex
+        {
+            SLOT,
+            SEQ,
+            TIME,
+            NAME,
+            USER_NAME,
+            OLD_VALUE,
+            NEW_VALUE,
+            COUNT_,
+        };
+
+        /********
+        * Table *
+        ********/
+        virtual String GetTableName()    const override { return StaticGetTableName(); }
+
+        /***************
+        * IdBasedTable *
+        ***************/
+        virtual int GetFieldIndexOfId() const { return SLOT; }
+
+        /********************
+        * ParamHistoryTable *
+        ********************/
+        static String StaticGetTableName();
+        // The layout, see StaticTable.
+        static FieldEntry const &StaticGetField(int index)
+        {
+            static FieldEntry const fields[] =
+            {
+                { SL("slot"),     BIT_INTID | BIT_PKEYASC,  SL("") },
+                { SL("seq"),      BIT_INT64 | BIT_UNIQUE,   SL("") },
+                { SL("time"),     BIT_INT64,                SL("") },
+                { SL("name"),     BIT_NCSTR,                SL("") },
+                { SL("userName"), BIT_NCSTR,                SL("") },
+                { SL("oldValue"), BIT_VARIANT | BIT_NULLOK, SL("") },
+                { SL("newValue"), BIT_VARIANT | BIT_NULLOK, SL("") },
+            };
+
+            BOOST_STATIC_ASSERT(sizeof(fields) / sizeof(fields[0]) == COUNT_);
+            return fields[index];
+        }
+
+        // Indexes the name and time when the table is created.
+        virtual void Index();
+
+        // The sequence number of the latest change, 0 if there is none.
+        // Read it once per write transaction, the transaction keeps other
+        // connections from writing until it ends.
+        Int64 SelectLastSeq() const;
+
+        // Logs a change of the param to the new value, with the next
+        // sequence number. The old value is read from the param table, so
+        // this must run before the change, in the same transaction.
+        void Insert(Int64 seq, String const &name, Int64 time, String const &userName, Int32  newValue);
+        void Insert(Int64 seq, String const &name, Int64 time, String const &userName, double newValue);
+        void Insert(Int64 seq, String const &name, Int64 time, String const &userName, Binary const &newValue);
+
+        // The changes of the param in [fromTime, toTime], oldest first.
+        void Select(String const &name, Int64 fromTime, Int64 toTime, std::vector<ParamHistoryRow> &rows) const;
+
+    private:
+        template <class T> void InsertT(Int64 seq, String const &name, Int64 time, String const &userName, T const &newValue);
+
+        void BindValue(StatementPtr const &q, Int32 index, Int32  value) const { Bind(q, index, value); }
+        void BindValue(StatementPtr const &q, Int32 index, double value) const { Bind(q, index, value); }
+        void BindValue(StatementPtr const &q, Int32 index, Binary const &) const { q->bind(index); }
+
+        Int64 const          capacity;
+        StatementPtr         insert;
+        StatementPtr mutable select;
+        StatementPtr mutable selectLastSeq;
+    };
+}
+}
+#endif/*AOI_SYSTEMSTORE_PARAM_HISTORY_TABLE_H*/
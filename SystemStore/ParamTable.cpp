@@ -8,6 +8,19 @@
  *   Four characters. No tabs!
  *
  * Modifications
+ *   2026-10-17 (XSG) SelectValue returns false for a missing param.
+ *   2026-10-17 (XSG) Took the value select from the statement cache on each call.
+ *   2026-10-17 (XSG) Moved the layout literals and the field table back here.
+ *   2026-10-17 (XSG) Gave SelectBlob a statement of its own.
+ *   2026-10-17 (XSG) Added SelectDataVersion.
+ *   2026-10-17 (XSG) Moved the field table to the header.
+ *   2026-10-17 (XSG) Wrote the SQL of the frequent statements as literals.
+ *   2026-10-17 (XSG) Took the scan statements from the statement cache.
+ *   2026-10-17 (XSG) Kept the insert statement after a failed insert.
+ *   2026-10-17 (XSG) Added blob values.
+ *   2026-10-17 (XSG) Added SelectUnder for prefix scans.
+ *   2026-10-17 (XSG) Added SelectCount and SelectAll for preloading.
+ *   2026-10-17 (XSG) Stored values natively as integer or real instead of text.
  *   2010-12-06 (XSG) Created.
  *
  * Copyright (c) 2016-2017 Keysight Technologies, Inc.  All rights reserved.
@@ -20,93 +33,336 @@ namespace AOI
 {
 namespace SystemStore
 {
+    // The layout as literals, shared by the field table and the SQL of the
+    // frequent statements, which the compiler puts together.
+    #define PARAM_TABLE     "param"
+    #define PARAM_ID        "id"
+    #define PARAM_NAME      "name"
+    #define PARAM_VALUE     "value"
+
+    // Scans return an empty blob in place of a blob value, so that the
+    // content of a large blob is never read. typeof() does not load it.
+    #define PARAM_SCALAR_VALUE  "case when typeof(" PARAM_VALUE ") = 'blob' then x'' else " PARAM_VALUE " end"
+
     namespace
     {
-        Table::FieldEntry const myFields[] =
-        {
-            { SL("id"),           Table::BIT_INTID | Table::BIT_PKEYINC, SL("") },
-            { SL("name"),         Table::BIT_NCSTR | Table::BIT_UNIQUE,  SL("") },
-            { SL("value"),        Table::BIT_NCSTR,                      SL("") },
-        };
+        // Shared by SelectValue and SelectBlob.
+        String::value_type const SELECT_VALUE[] = SL("select " PARAM_VALUE " from " PARAM_TABLE " where " PARAM_NAME " = ?;");
 
-        BOOST_STATIC_ASSERT(sizeof(myFields) / sizeof(myFields[0]) == ParamTable::COUNT_);
-    }
+        // The storage class of the row decides how the value is read, so
+        // there is no text parsing.
+        void ReadValue(SQLite::Column const &column, ParamValue &value)
+        {
+            if (column.isInteger())
+            {
+                value.type     = Enum::ParamType::INT;
+                value.intValue = column.getInt64();
+            }
+            else if (column.isBlob())
+            {
+                value.type      = Enum::ParamType::BLOB;
+                value.intValue  = 0;
+                value.realValue = 0.;
+            }
+            else
+            {
+                value.type      = Enum::ParamType::REAL;
+                value.realValue = column.getDouble();
+            }
+        }
 
-    /***********************
-    * Table implementation *
-    ***********************/
-    int ParamTable::GetFieldBits(int index) const
-    {
-        assert(index >= 0 && index < GetFieldCount() && "Field index out of range in SQLiteImpl1::PrConfigTable::GetFieldBits.");
-        return myFields[index].fieldBits;
-    }
+        // The least string above every string that starts with the prefix,
+        // or an empty string if there is none.
+        String PrefixEnd(String prefix)
+        {
+            while (!prefix.empty() && static_cast<unsigned char>(prefix.back()) == 0xFF)
+                prefix.pop_back();
+            if (!prefix.empty())
+                prefix.back() = static_cast<char>(static_cast<unsigned char>(prefix.back()) + 1);
+            return prefix;
+        }
 
-    String ParamTable::GetFieldName(int index) const
-    {
-        assert(index >= 0 && index < GetFieldCount() && "Field index out of range in SQLiteImpl1::PrConfigTable::GetFieldName.");
-        return myFields[index].fieldName;
+        void VisitRows(SQLite::Statement &query, ParamTable::ParamVisitor const &visitor)
+        {
+            ParamValue value;
+            while (query.executeStep())
+            {
+                // getBytes() is only meaningful after getText().
+                SQLite::Column name   = query.getColumn(0);
+                char const    *text   = name.getText();
+                size_t const   length = static_cast<size_t>(name.getBytes());
+                ReadValue(query.getColumn(1), value);
+                if (!visitor(text, length, value))
+                    break;
+            }
+        }
     }
 
-    String ParamTable::GetFieldSql(int index) const
-    {
-        assert(index >= 0 && index < GetFieldCount() && "Field index out of range in SQLiteImpl1::PrConfigTable::GetFieldSql.");
-        return myFields[index].fieldSql;
-    }    
-
     /*******************************
     * PrConfigTable implementation *
     *******************************/
 
     /*static*/String ParamTable::StaticGetTableName()
     {
-        return SL("param");
+        return SL(PARAM_TABLE);
     }
 
-    Int64 ParamTable::Insert(String const &name, String const &value)
+    /*static*/Table::FieldEntry const &ParamTable::StaticGetField(int index)
+    {
+        static FieldEntry const fields[] =
+        {
+            { SL(PARAM_ID),    BIT_INTID | BIT_PKEYINC, SL("") },
+            { SL(PARAM_NAME),  BIT_NCSTR | BIT_UNIQUE,  SL("") },
+            { SL(PARAM_VALUE), BIT_VARIANT,             SL("") },
+        };
+
+        BOOST_STATIC_ASSERT(sizeof(fields) / sizeof(fields[0]) == COUNT_);
+        return fields[index];
+    }
+
+    template <class T> Int64 ParamTable::InsertT(String const &name, T const &value)
     {
         try
         {
             if (!this->insert)
-            {
-                int const fi[] = { NAME, VALUE };
-                this->insert = BuildInsertCommand(fi, fi + sizeof(fi) / sizeof(fi[0]));
-            }
+                this->insert = Prepare(SL("insert into " PARAM_TABLE " (" PARAM_NAME ", " PARAM_VALUE ") values (?, ?);"));
 
             int i = 0;
             Bind(this->insert, ++i, name);
-            Bind(this->insert, ++i, value);
+            BindValue(this->insert, ++i, value);
             Exec(this->insert);
 
             return GetLastInsertedRowId();
         }
         catch (...)
         {
-            this->insert.reset();
+            if (this->insert)
+                ResetAfterError(this->insert);
             throw;
         }
     }
 
-    void ParamTable::SelectValue(String const &name, String &value) const
+    Int64 ParamTable::Insert(String const &name, Int32 value)
     {
-        this->selectValue = BuildSelectCommand(VALUE, NAME);
+        return InsertT(name, value);
+    }
+
+    Int64 ParamTable::Insert(String const &name, double value)
+    {
+        return InsertT(name, value);
+    }
+
+    Int64 ParamTable::Insert(String const &name, Binary const &value)
+    {
+        return InsertT(name, value);
+    }
+
+    bool ParamTable::SelectValue(String const &name, ParamValue &value) const
+    {
+        // Taken from the cache on each call rather than kept, so that
+        // SelectBlob can reuse it too.
+        StatementPtr const query = Prepare(SELECT_VALUE);
+        try
+        {
+            Bind(query, 1, name);
+            bool const found = query->executeStep();
 
-        Bind(this->selectValue, 1, name);
-        Exec(this->selectValue, value);
+            // Column indexes are zero-based.
+            if (found)
+                ReadValue(query->getColumn(0), value);
+            query->reset();
+            return found;
+        }
+        catch (...)
+        {
+            // The statement is cached for reuse, so it must be reset.
+            ResetAfterError(query);
+            throw;
+        }
     }
     
-    void ParamTable::UpdateValue(String const &name, String const &value)
+    void ParamTable::SelectBlob(String const &name, BlobVisitor const &visitor) const
     {
-        if (!this->updateByName)
+        // Taken from the cache on each call, so a visitor that views
+        // another blob or reads a param meanwhile gets a statement of its own.
+        StatementPtr const query = Prepare(SELECT_VALUE);
+        try
+        {
+            Bind(query, 1, name);
+            query->executeStep();
+
+            // The buffer belongs to the statement and is freed by the reset,
+            // so the visitor sees it without a copy.
+            SQLite::Column column = query->getColumn(0);
+            if (!column.isBlob())
+                throw SQLite::Exception(SL("Param ") + name + SL(" is not binary."));
+
+            void const  *data = column.getBlob();
+            size_t const size = static_cast<size_t>(column.getBytes());
+            visitor(data, size);
+            query->reset();
+        }
+        catch (...)
         {
-            String fmt = SL("update %s set %s = ? where %s = ?;");
-            String sql = (boost::format(fmt) % GetTableName() % GetFieldName(VALUE) % GetFieldName(NAME)).str();
-            this->updateByName = std::make_shared<SQLite::Statement>(*GetDatabase().get(), sql);
+            ResetAfterError(query);
+            throw;
         }
+    }
+
+    Int64 ParamTable::SelectCount() const
+    {
+        if (!this->selectCount)
+            this->selectCount = Prepare(SL("select count(*) from " PARAM_TABLE ";"));
+
+        Int64 count = 0;
+        Exec(this->selectCount, count);
+        return count;
+    }
+
+    Int64 ParamTable::SelectDataVersion() const
+    {
+        if (!this->selectDataVersion)
+            this->selectDataVersion = Prepare(SL("pragma data_version;"));
+
+        Int64 version = 0;
+        Exec(this->selectDataVersion, version);
+        return version;
+    }
+
+    void ParamTable::SelectAll(ParamVisitor const &visitor) const
+    {
+        StatementPtr const query = Prepare(SL("select " PARAM_NAME ", " PARAM_SCALAR_VALUE " from " PARAM_TABLE ";"));
+        try
+        {
+            VisitRows(*query, visitor);
+            query->reset();
+        }
+        catch (...)
+        {
+            ResetAfterError(query);
+            throw;
+        }
+    }
+
+    void ParamTable::SelectUnder(String const &prefix, ParamVisitor const &visitor) const
+    {
+        // The name column has binary collation, so the names that start
+        // with the prefix are exactly those in [prefix, PrefixEnd(prefix)).
+        // A like or glob pattern would not use the index.
+        String const end = PrefixEnd(prefix);
+
+        // Reset when done, so the cache can hand it out again. A visitor
+        // that starts another scan meanwhile gets a statement of its own.
+        StatementPtr const query = Prepare(end.empty()
+            ? SL("select " PARAM_NAME ", " PARAM_SCALAR_VALUE " from " PARAM_TABLE " where " PARAM_NAME " >= ? order by " PARAM_NAME ";")
+            : SL("select " PARAM_NAME ", " PARAM_SCALAR_VALUE " from " PARAM_TABLE " where " PARAM_NAME " >= ? and " PARAM_NAME " < ? order by " PARAM_NAME ";"));
+        try
+        {
+            Bind(query, 1, prefix);
+            if (!end.empty())
+                Bind(query, 2, end);
+            VisitRows(*query, visitor);
+            query->reset();
+        }
+        catch (...)
+        {
+            ResetAfterError(query);
+            throw;
+        }
+    }
+
+    template <class T> bool ParamTable::UpdateValueT(String const &name, T const &value)
+    {
+        try
+        {
+            if (!this->updateByName)
+                this->updateByName = Prepare(SL("update " PARAM_TABLE " set " PARAM_VALUE " = ? where " PARAM_NAME " = ?;"));
+
+            int i = 0;
+            BindValue(this->updateByName, ++i, value);
+            Bind(this->updateByName, ++i, name);
+            return Exec(this->updateByName) > 0;
+        }
+        catch (...)
+        {
+            if (this->updateByName)
+                ResetAfterError(this->updateByName);
+            throw;
+        }
+    }
+
+    bool ParamTable::UpdateValue(String const &name, Int32 value)
+    {
+        return UpdateValueT(name, value);
+    }
+
+    bool ParamTable::UpdateValue(String const &name, double value)
+    {
+        return UpdateValueT(name, value);
+    }
+
+    bool ParamTable::UpdateValue(String const &name, Binary const &value)
+    {
+        return UpdateValueT(name, value);
+    }
+
+    template <class T> bool ParamTable::UpsertT(String const &name, T const &value)
+    {
+        // SQLite 3.15 has no "on conflict do update", and "insert or replace"
+        // cannot tell whether the row existed. The update runs first since
+        // the param usually exists, the insert only when nothing changed.
+        if (UpdateValueT(name, value))
+            return false;
+
+        InsertT(name, value);
+        return true;
+    }
+
+    bool ParamTable::Upsert(String const &name, Int32 value)
+    {
+        return UpsertT(name, value);
+    }
+
+    bool ParamTable::Upsert(String const &name, double value)
+    {
+        return UpsertT(name, value);
+    }
+
+    bool ParamTable::Upsert(String const &name, Binary const &value)
+    {
+        return UpsertT(name, value);
+    }
+
+    bool ParamTable::Migrate()
+    {
+        // The old layout declared the value column as text, which makes
+        // SQLite convert every bound number back into text.
+        bool legacy = false;
+        {
+            SQLite::Statement query(*GetDatabase().get(), SL("pragma table_info(") + GetTableName() + SL(");"));
+            while (query.executeStep())
+                if (query.getColumn(1).getString() == GetFieldName(VALUE))
+                    legacy = boost::iequals(query.getColumn(2).getString(), SL("text"));
+        }
+        if (!legacy)
+            return false;
+
+        String const tn  = GetTableName();
+        String const old = tn + SL("_legacy");
+
+        SQLite::Transaction transaction(*GetDatabase().get());
+        GetDatabase()->exec(SL("alter table ") + tn + SL(" rename to ") + old + SL(";"));
+        Create();
 
-        int i = 0;
-        Bind(this->updateByName, ++i, value);
-        Bind(this->updateByName, ++i, name);
-        Exec(this->updateByName);
+        // Values were written with std::to_string, so anything other than
+        // digits and a sign was a double.
+        String const fmt = SL("insert into %1% (%2%, %3%, %4%) select %2%, %3%, ")
+                           SL("case when %4% glob '*[^0-9+-]*' or %4% = '' then cast(%4% as real) else cast(%4% as integer) end ")
+                           SL("from %5%;");
+        GetDatabase()->exec((boost::format(fmt) % tn % GetFieldName(ID) % GetFieldName(NAME) % GetFieldName(VALUE) % old).str());
+        GetDatabase()->exec(SL("drop table ") + old + SL(";"));
+        transaction.commit();
+        return true;
     }
 }
 }
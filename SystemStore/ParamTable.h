@@ -10,12 +10,17 @@
  *   Four characters. No tabs!
  *
  * Modifications
+ *   2026-10-17 (XSG) SelectValue returns false for a missing param.
+ *   2026-10-17 (XSG) Moved the layout literals back to the implementation.
+ *   2026-10-17 (XSG) Described the fields inline through StaticTable.
+ *   2026-10-17 (XSG) Stored values natively as integer or real instead of text.
  *   2016-09-16 (XSG) Created.
  *
  * Copyright (c) 2016-2017 Xiao Shengguang.  All rights reserved.
  ****************************************************************************/
 
 #include "IdBasedTable.h"
+#include "StaticTable.h"
 
 namespace AOI
 {
@@ -25,12 +30,26 @@ namespace SystemStore
 
     using ParamTablePtr = std::shared_ptr<ParamTable>;
 
-    class ParamTable: public IdBasedTable
+    // A param value as stored, tagged with the storage class of its row.
+    struct ParamValue
+    {
+        Enum::ParamType type;
+        Int64           intValue;
+        double          realValue;
+
+        ParamValue() : type(Enum::ParamType::UNDEFINED), intValue(0), realValue(0.) {}
+
+        // A blob has no scalar value here, its content is not cached.
+        Int32  AsInt32 () const { return type == Enum::ParamType::REAL ? static_cast<Int32>(realValue) : static_cast<Int32>(intValue); }
+        double AsDouble() const { return type == Enum::ParamType::REAL ? realValue : static_cast<double>(intValue); }
+    };
+
+    class ParamTable: public StaticTable<ParamTable, IdBasedTable>
     {
         using IdBasedTable::Select;
 
     public:
-        explicit ParamTable(DatabasePtr const &database): IdBasedTable(database) {}
+        explicit ParamTable(DatabasePtr const &database): StaticTable(database) {}
         virtual ~ParamTable() {}
 
         enum FieldIndex
@@ -45,10 +64,6 @@ namespace SystemStore
         * Table *
         ********/
         virtual String GetTableName()    const override { return StaticGetTableName(); }
-        virtual int    GetFieldCount()   const override { return COUNT_; }
-        virtual String GetFieldName(int) const override;
-        virtual int    GetFieldBits(int) const override;
-        virtual String GetFieldSql (int) const override;
 
         /***************
         * IdBasedTable *
@@ -59,15 +74,63 @@ namespace SystemStore
         * ParamTable *
         *************/
         static String StaticGetTableName();
+        // The layout, see StaticTable.
+        static FieldEntry const &StaticGetField(int index);
+
+        Int64 Insert(String const &name, Int32  value);
+        Int64 Insert(String const &name, double value);
+        Int64 Insert(String const &name, Binary const &value);
+        // Returns false if the param does not exist.
+        bool SelectValue(String const &name, ParamValue &) const;
 
-        Int64 Insert(String const &name, String const &value);
-        void SelectValue(String const &name, String &) const;
-        void UpdateValue        (String const &name, String const &);
+        // Hands the visitor SQLite's buffer of a blob param, which is only
+        // valid during the call. Throws if the param is not a blob. The
+        // visitor may read other params, with a statement of their own.
+        typedef std::function<void(void const *data, size_t size)> BlobVisitor;
+        void SelectBlob(String const &name, BlobVisitor const &) const;
+
+        // Receives the rows of a scan. The name is not null-terminated and
+        // is only valid during the call. Returning false stops the scan.
+        typedef std::function<bool(char const *name, size_t length, ParamValue const &)> ParamVisitor;
+
+        Int64 SelectCount() const;
+        // The data version of the connection, which changes when another
+        // connection commits a write (PRAGMA data_version).
+        Int64 SelectDataVersion() const;
+        // Visits every param with one statement and one pass over the table.
+        void  SelectAll(ParamVisitor const &) const;
+        // Visits the params whose names start with the prefix, in name
+        // order. This is a range scan of the unique index on the name.
+        void  SelectUnder(String const &prefix, ParamVisitor const &) const;
+        // Returns false if there is no param with the name.
+        bool UpdateValue        (String const &name, Int32);
+        bool UpdateValue        (String const &name, double);
+        bool UpdateValue        (String const &name, Binary const &);
+
+        // Updates the param or inserts it if it does not exist. Returns
+        // true if a row was created.
+        bool Upsert             (String const &name, Int32);
+        bool Upsert             (String const &name, double);
+        bool Upsert             (String const &name, Binary const &);
+
+        // Converts a table created with the old single text value column
+        // into the typed layout. Returns false if there was nothing to do.
+        bool Migrate();
 
     private:
+        template <class T> Int64 InsertT     (String const &name, T const &value);
+        template <class T> bool  UpdateValueT(String const &name, T const &value);
+        template <class T> bool  UpsertT     (String const &name, T const &value);
+
+        void BindValue(StatementPtr const &q, Int32 index, Int32  value) const { Bind(q, index, value); }
+        void BindValue(StatementPtr const &q, Int32 index, double value) const { Bind(q, index, value); }
+        // Not copied, a blob is only read by the step that follows.
+        void BindValue(StatementPtr const &q, Int32 index, Binary const &value) const { BindNoCopy(q, index, value); }
+
         StatementPtr         insert;
         StatementPtr         insertAll;
-        StatementPtr mutable selectValue;
+        StatementPtr mutable selectCount;
+        StatementPtr mutable selectDataVersion;
         StatementPtr         updateByName;
     };
 }
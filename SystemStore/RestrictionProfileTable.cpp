@@ -0,0 +1,115 @@
+/*****************************************************************************
+ * RestrictionProfileTable.cpp -- $Id$
+ *
+ * Purpose
+ *   Implements the RestrictionProfileTable class.
+ *
+ * Indentation
+ *   Four characters. No tabs!
+ *
+ * Modifications
+ *   2026-10-17 (XSG) Moved the field table back here.
+ *   2026-10-17 (XSG) Moved the field table to the header.
+ *   2026-10-17 (XSG) Wrote the SQL of the frequent statements as literals.
+ *   2026-10-17 (XSG) Created.
+ *
+ * Copyright (c) 2026 Xiao Shengguang.  All rights reserved.
+ ****************************************************************************/
+
+#include "Common/BaseDefs.h"
+#include "RestrictionProfileTable.h"
+#include "RestrictionProfileTableLayout.h"
+
+namespace AOI
+{
+namespace SystemStore
+{
+    namespace
+    {
+        // 64-bit FNV-1a. Only used to find candidates, the documents are
+        // compared as well.
+        Int64 Hash(String const &document)
+        {
+            unsigned __int64 hash = 14695981039346656037ULL;
+            for (size_t i = 0, n = document.size(); i != n; ++i)
+            {
+                hash ^= static_cast<unsigned char>(document[i]);
+                hash *= 1099511628211ULL;
+            }
+            return static_cast<Int64>(hash);
+        }
+    }
+
+    /*****************************************
+    * RestrictionProfileTable implementation *
+    *****************************************/
+
+    /*static*/String RestrictionProfileTable::StaticGetTableName()
+    {
+        return SL(RESTRICTION_PROFILE_TABLE);
+    }
+
+    /*static*/Table::FieldEntry const &RestrictionProfileTable::StaticGetField(int index)
+    {
+        static FieldEntry const fields[] =
+        {
+            { SL(RESTRICTION_PROFILE_ID),       BIT_INTID | BIT_PKEYINC, SL("") },
+            { SL(RESTRICTION_PROFILE_HASH),     BIT_INT64,               SL("") },
+            { SL(RESTRICTION_PROFILE_DOCUMENT), BIT_NCSTR,               SL("") },
+        };
+
+        BOOST_STATIC_ASSERT(sizeof(fields) / sizeof(fields[0]) == COUNT_);
+        return fields[index];
+    }
+
+    void RestrictionProfileTable::Index()
+    {
+        String const fmt = SL("create index %1%_%2% on %1% (%2%);");
+        GetDatabase()->exec((boost::format(fmt) % GetTableName() % GetFieldName(HASH)).str());
+    }
+
+    Int64 RestrictionProfileTable::Intern(String const &document)
+    {
+        Int64 const hash = Hash(document);
+        try
+        {
+            if (!this->selectByHash)
+                this->selectByHash = Prepare(SL("select " RESTRICTION_PROFILE_ID " from " RESTRICTION_PROFILE_TABLE
+                    " where " RESTRICTION_PROFILE_HASH " = ? and " RESTRICTION_PROFILE_DOCUMENT " = ?;"));
+
+            Bind(this->selectByHash, 1, hash);
+            Bind(this->selectByHash, 2, document);
+            if (this->selectByHash->executeStep())
+            {
+                Int64 const id = this->selectByHash->getColumn(0).getInt64();
+                this->selectByHash->reset();
+                return id;
+            }
+            this->selectByHash->reset();
+        }
+        catch (...)
+        {
+            if (this->selectByHash)
+                ResetAfterError(this->selectByHash);
+            throw;
+        }
+
+        try
+        {
+            if (!this->insert)
+                this->insert = Prepare(SL("insert into " RESTRICTION_PROFILE_TABLE " (" RESTRICTION_PROFILE_HASH ", " RESTRICTION_PROFILE_DOCUMENT ") values (?, ?);"));
+
+            Bind(this->insert, 1, hash);
+            Bind(this->insert, 2, document);
+            Exec(this->insert);
+            return GetLastInsertedRowId();
+        }
+        catch (...)
+        {
+            if (this->insert)
+                ResetAfterError(this->insert);
+            throw;
+        }
+    }
+}
+}
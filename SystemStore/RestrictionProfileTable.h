@@ -0,0 +1,81 @@
+#ifndef AOI_SYSTEMSTORE_RESTRICTION_PROFILE_TABLE_H
+#define AOI_SYSTEMSTORE_RESTRICTION_PROFILE_TABLE_H
+/*****************************************************************************
+ * RestrictionProfileTable.h -- $Id$
+ *
+ * Purpose
+ *   Declares the RestrictionProfileTable class, which stores each distinct
+ *   restriction document once for the users that share it.
+ *
+ * Indentation
+ *   Four characters. No tabs!
+ *
+ * Modifications
+ *   2026-10-17 (XSG) Moved the layout literals to RestrictionProfileTableLayout.h.
+ *   2026-10-17 (XSG) Indexed the hash in Index, not in Create.
+ *   2026-10-17 (XSG) Described the fields inline through StaticTable.
+ *   2026-10-17 (XSG) Declared the layout as literals for the SQL of the user table.
+ *   2026-10-17 (XSG) Created.
+ *
+ * Copyright (c) 2026 Xiao Shengguang.  All rights reserved.
+ ****************************************************************************/
+
+#include "IdBasedTable.h"
+#include "StaticTable.h"
+
+namespace AOI
+{
+namespace SystemStore
+{
+    class RestrictionProfileTable;
+
+    using RestrictionProfileTablePtr = std::shared_ptr<RestrictionProfileTable>;
+
+    // A profile is never changed once written, so changing a user's
+    // restriction means pointing the user at another profile (copy on
+    // write). Profiles are found by a hash of the document.
+    class RestrictionProfileTable: public StaticTable<RestrictionProfileTable, IdBasedTable>
+    {
+    public:
+        explicit RestrictionProfileTable(DatabasePtr const &database): StaticTable(database) {}
+        virtual ~RestrictionProfileTable() {}
+
+        enum FieldIndex
+        {
+            ID,
+            HASH,
+            DOCUMENT,
+            COUNT_,
+        };
+
+        /********
+        * Table *
+        ********/
+        virtual String GetTableName()    const override { return StaticGetTableName(); }
+
+        /***************
+        * IdBasedTable *
+        ***************/
+        virtual int GetFieldIndexOfId() const { return ID; }
+
+        /**************************
+        * RestrictionProfileTable *
+        **************************/
+        static String StaticGetTableName();
+        // The layout, see StaticTable.
+        static FieldEntry const &StaticGetField(int index);
+
+        // Indexes the hash when the table is created.
+        virtual void Index();
+
+        // The id of the profile with the document, which is inserted if
+        // there is none yet.
+        Int64 Intern(String const &document);
+
+    private:
+        StatementPtr            selectByHash;
+        StatementPtr            insert;
+    };
+}
+}
+#endif/*AOI_SYSTEMSTORE_RESTRICTION_PROFILE_TABLE_H*/
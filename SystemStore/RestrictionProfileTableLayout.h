@@ -0,0 +1,26 @@
+#ifndef AOI_SYSTEMSTORE_RESTRICTION_PROFILE_TABLE_LAYOUT_H
+#define AOI_SYSTEMSTORE_RESTRICTION_PROFILE_TABLE_LAYOUT_H
+/*****************************************************************************
+ * RestrictionProfileTableLayout.h -- $Id$
+ *
+ * Purpose
+ *   Defines the layout of the restriction profile table as literals. Only
+ *   included by the implementation files that put its SQL together.
+ *
+ * Indentation
+ *   Four characters. No tabs!
+ *
+ * Modifications
+ *   2026-10-17 (XSG) Created.
+ *
+ * Copyright (c) 2026 Xiao Shengguang.  All rights reserved.
+ ****************************************************************************/
+
+// The layout as literals, so that SQL naming the table can be put together
+// by the compiler, in the profile table and in the user table.
+#define RESTRICTION_PROFILE_TABLE       "restriction_profile"
+#define RESTRICTION_PROFILE_ID          "id"
+#define RESTRICTION_PROFILE_HASH        "hash"
+#define RESTRICTION_PROFILE_DOCUMENT    "document"
+
+#endif/*AOI_SYSTEMSTORE_RESTRICTION_PROFILE_TABLE_LAYOUT_H*/
@@ -0,0 +1,113 @@
+/*****************************************************************************
+ * RestrictionSet.cpp -- $Id$
+ *
+ * Purpose
+ *   Implements the RestrictionKeys and RestrictionSet classes.
+ *
+ * Indentation
+ *   Four characters. No tabs!
+ *
+ * Modifications
+ *   2026-10-17 (XSG) Split the parse of a document from its compile.
+ *   2026-10-17 (XSG) Read the document with the property tree XML parser.
+ *   2026-10-17 (XSG) Created.
+ *
+ * Copyright (c) 2026 Xiao Shengguang.  All rights reserved.
+ ****************************************************************************/
+
+#include "Common/BaseDefs.h"
+#include "RestrictionSet.h"
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+#include <sstream>
+
+namespace AOI
+{
+namespace SystemStore
+{
+    namespace
+    {
+        typedef boost::property_tree::ptree Tree;
+
+        // Collects the restriction elements at any depth below node, each
+        // key with whether it is allowed.
+        void ReadRestrictions(Tree const &node, RestrictionEntries &entries)
+        {
+            for (auto const &child : node)
+            {
+                if (child.first == SL("restriction"))
+                {
+                    auto const key = child.second.get_optional<String>(SL("<xmlattr>.key"));
+                    if (key)
+                    {
+                        auto value = child.second.get_optional<String>(SL("<xmlattr>.value"));
+                        if (!value)
+                            value = child.second.get_optional<String>(SL("<xmlattr>.default"));
+                        entries.push_back(std::make_pair(*key, value && boost::iequals(*value, SL("true"))));
+                    }
+                }
+                ReadRestrictions(child.second, entries);
+            }
+        }
+    }
+
+    /*********************************
+    * RestrictionKeys implementation *
+    *********************************/
+    Int32 RestrictionKeys::Intern(String const &key)
+    {
+        auto const inserted = this->handles.insert(std::make_pair(key, static_cast<Int32>(this->handles.size())));
+        return inserted.first->second;
+    }
+
+    Int32 RestrictionKeys::Find(String const &key) const
+    {
+        auto const it = this->handles.find(key);
+        return (it == this->handles.end()) ? Int32(NO_HANDLE) : it->second;
+    }
+
+    /********************************
+    * RestrictionSet implementation *
+    ********************************/
+    /*static*/void RestrictionSet::Parse(String const &document, RestrictionEntries &entries)
+    {
+        entries.clear();
+        Tree tree;
+        try
+        {
+            std::istringstream stream(document);
+            boost::property_tree::read_xml(stream, tree);
+        }
+        catch (boost::property_tree::xml_parser_error const &)
+        {
+            return;
+        }
+        ReadRestrictions(tree, entries);
+    }
+
+    /*static*/RestrictionSet RestrictionSet::Compile(RestrictionEntries const &entries, RestrictionKeys &keys)
+    {
+        RestrictionSet set;
+        for (auto const &entry : entries)
+            set.Set(keys.Intern(entry.first), entry.second);
+        return set;
+    }
+
+    void RestrictionSet::Set(Int32 handle, bool allowed)
+    {
+        size_t const word = static_cast<size_t>(handle) / WORD_BITS;
+        unsigned __int64 const mask = static_cast<unsigned __int64>(1) << (handle % WORD_BITS);
+        if (word >= this->bits.size())
+        {
+            if (!allowed)
+                return;
+            this->bits.resize(word + 1, 0);
+        }
+
+        if (allowed)
+            this->bits[word] |= mask;
+        else
+            this->bits[word] &= ~mask;
+    }
+}
+}
@@ -0,0 +1,76 @@
+#ifndef AOI_SYSTEMSTORE_RESTRICTION_SET_H
+#define AOI_SYSTEMSTORE_RESTRICTION_SET_H
+/*****************************************************************************
+ * RestrictionSet.h -- $Id$
+ *
+ * Purpose
+ *   Declares the RestrictionKeys class, which interns restriction keys to
+ *   handles, and the RestrictionSet class, a user's restriction document
+ *   compiled to one bit per key handle.
+ *
+ * Indentation
+ *   Four characters. No tabs!
+ *
+ * Modifications
+ *   2026-10-17 (XSG) Split the parse of a document from its compile.
+ *   2026-10-17 (XSG) Read the document with the property tree XML parser.
+ *   2026-10-17 (XSG) Created.
+ *
+ * Copyright (c) 2026 Xiao Shengguang.  All rights reserved.
+ ****************************************************************************/
+
+#include "Common/BaseDefs.h"
+#include <unordered_map>
+
+namespace AOI
+{
+namespace SystemStore
+{
+    // Handles are dense, in the order the keys are first seen, so they index
+    // the bits of every RestrictionSet compiled with the same keys.
+    class RestrictionKeys: private Uncopyable
+    {
+    public:
+        enum { NO_HANDLE = -1 };
+
+        Int32 Intern(String const &key);
+
+        // NO_HANDLE if the key was never interned.
+        Int32 Find(String const &key) const;
+
+    private:
+        std::unordered_map<String, Int32> handles;
+    };
+
+    // The keys a document names, each with whether it is allowed.
+    typedef std::vector<std::pair<String, bool>> RestrictionEntries;
+
+    class RestrictionSet
+    {
+    public:
+        // Reads the <restriction key="..." value="..."/> elements of the
+        // document, at any depth. A key is allowed if its value (or, without
+        // a value, its default) is "true". A document that is not well-formed
+        // XML names no keys. Parse uses no key handles, so it needs no lock.
+        static void Parse(String const &document, RestrictionEntries &entries);
+
+        // Keys the entries do not name are not allowed, so an empty
+        // document allows nothing.
+        static RestrictionSet Compile(RestrictionEntries const &entries, RestrictionKeys &);
+
+        bool IsAllowed(Int32 handle) const
+        {
+            size_t const word = static_cast<size_t>(handle) / WORD_BITS;
+            return handle >= 0 && word < this->bits.size() && ((this->bits[word] >> (handle % WORD_BITS)) & 1) != 0;
+        }
+
+    private:
+        enum { WORD_BITS = 64 };
+
+        void Set(Int32 handle, bool allowed);
+
+        std::vector<unsigned __int64> bits;
+    };
+}
+}
+#endif/*AOI_SYSTEMSTORE_RESTRICTION_SET_H*/
@@ -3,6 +3,9 @@
 
 #include <cstring>
 #include <exception>
+#include <system_error>
+#include <thread>
+#include <vector>
 #include "Rijndael.h"
 
 const int CRijndael::sm_alog[256] =
@@ -952,6 +955,7 @@ void CRijndael::MakeKey(char const* key, char const* chain, int keylength, int b
 	//Initialize the chain
 	memcpy(m_chain0, chain, m_blockSize);
 	memcpy(m_chain, chain, m_blockSize);
+	m_ctrUsed = DEFAULT_BLOCK_SIZE;
 	//Calculate Number of Rounds
 	switch(m_keylength)
 	{
@@ -1039,18 +1043,60 @@ void CRijndael::MakeKey(char const* key, char const* chain, int keylength, int b
 				sm_U3[(tt >>  8) & 0xFF] ^
 				sm_U4[tt & 0xFF];
 		}
+	//Byte copies of the round keys for the vector paths
+	m_iPath = PATH_TABLE;
+	if(DEFAULT_BLOCK_SIZE == m_blockSize)
+	{
+		for(int r=0; r<=m_iROUNDS; r++)
+			for(i=0; i<DEFAULT_BLOCK_SIZE; i++)
+			{
+				m_KeBytes[r][i] = (unsigned char)(m_Ke[r][i/4] >> (24 - 8*(i%4)));
+				m_KdBytes[r][i] = (unsigned char)(m_Kd[r][i/4] >> (24 - 8*(i%4)));
+			}
+		if(IsPathSupported(PATH_AESNI))
+			m_iPath = PATH_AESNI;
+		else if(IsPathSupported(PATH_SSSE3))
+			m_iPath = PATH_SSSE3;
+	}
 	m_bKeyInit = true;
 }
 
+bool CRijndael::IsPathSupported(int iPath)
+{
+	switch(iPath)
+	{
+		case PATH_TABLE:
+			return true;
+
+		case PATH_SSSE3:
+			return HasSsse3();
+
+		case PATH_AESNI:
+			return HasAesNi();
+
+		default:
+			return false;
+	}
+}
+
+void CRijndael::SetPath(int iPath)
+{
+	if(false==m_bKeyInit)
+		throw exception(sm_szErrorMsg1);
+	if(!IsPathSupported(iPath) || (PATH_TABLE != iPath && DEFAULT_BLOCK_SIZE != m_blockSize))
+		throw exception("Block path not supported");
+	m_iPath = iPath;
+}
+
 //Convenience method to encrypt exactly one block of plaintext, assuming
 //Rijndael's default block size (128-bit).
 // in         - The plaintext
 // result     - The ciphertext generated from a plaintext using the key
-void CRijndael::DefEncryptBlock(char const* in, char* result)
+void CRijndael::DefEncryptBlock(char const* in, char* result) const
 {
 	if(false==m_bKeyInit)
 		throw exception(sm_szErrorMsg1);
-	int* Ker = m_Ke[0];
+	int const* Ker = m_Ke[0];
 	int t0 = ((unsigned char)*(in++) << 24);
 	t0 |= ((unsigned char)*(in++) << 16);
 	t0 |= ((unsigned char)*(in++) << 8);
@@ -1121,11 +1167,11 @@ void CRijndael::DefEncryptBlock(char const* in, char* result)
 //Rijndael's default block size (128-bit).
 // in         - The ciphertext.
 // result     - The plaintext generated from a ciphertext using the session key.
-void CRijndael::DefDecryptBlock(char const* in, char* result)
+void CRijndael::DefDecryptBlock(char const* in, char* result) const
 {
 	if(false==m_bKeyInit)
 		throw exception(sm_szErrorMsg1);
-	int* Kdr = m_Kd[0];
+	int const* Kdr = m_Kd[0];
 	int t0 = ((unsigned char)*(in++) << 24);
 	t0 = t0 | ((unsigned char)*(in++) << 16);
 	t0 |= ((unsigned char)*(in++) << 8);
@@ -1194,13 +1240,25 @@ void CRijndael::DefDecryptBlock(char const* in, char* result)
 //Encrypt exactly one block of plaintext.
 // in           - The plaintext.
 // result       - The ciphertext generated from a plaintext using the key.
-void CRijndael::EncryptBlock(char const* in, char* result)
+void CRijndael::EncryptBlock(char const* in, char* result) const
 {
 	if(false==m_bKeyInit)
 		throw exception(sm_szErrorMsg1);
-    if(DEFAULT_BLOCK_SIZE == m_blockSize)
+	if(DEFAULT_BLOCK_SIZE == m_blockSize)
 	{
-		DefEncryptBlock(in, result);
+		switch(m_iPath)
+		{
+			case PATH_AESNI:
+				AesNiEncryptBlock(in, result);
+				break;
+
+			case PATH_SSSE3:
+				Ssse3EncryptBlock(in, result);
+				break;
+
+			default:
+				DefEncryptBlock(in, result);
+		}
 		return;
 	}
 	int BC = m_blockSize / 4;
@@ -1208,7 +1266,9 @@ void CRijndael::EncryptBlock(char const* in, char* result)
 	int s1 = sm_shifts[SC][1][0];
 	int s2 = sm_shifts[SC][2][0];
 	int s3 = sm_shifts[SC][3][0];
-	//Temporary Work Arrays
+	//Temporary Work Arrays, on the stack to keep the method reentrant
+	int t[MAX_BC];
+	int a[MAX_BC];
 	int i;
 	int tt;
 	int* pi = t;
@@ -1244,13 +1304,25 @@ void CRijndael::EncryptBlock(char const* in, char* result)
 //Decrypt exactly one block of ciphertext.
 // in         - The ciphertext.
 // result     - The plaintext generated from a ciphertext using the session key.
-void CRijndael::DecryptBlock(char const* in, char* result)
+void CRijndael::DecryptBlock(char const* in, char* result) const
 {
 	if(false==m_bKeyInit)
 		throw exception(sm_szErrorMsg1);
 	if(DEFAULT_BLOCK_SIZE == m_blockSize)
 	{
-		DefDecryptBlock(in, result);
+		switch(m_iPath)
+		{
+			case PATH_AESNI:
+				AesNiDecryptBlock(in, result);
+				break;
+
+			case PATH_SSSE3:
+				Ssse3DecryptBlock(in, result);
+				break;
+
+			default:
+				DefDecryptBlock(in, result);
+		}
 		return;
 	}
 	int BC = m_blockSize / 4;
@@ -1258,7 +1330,9 @@ void CRijndael::DecryptBlock(char const* in, char* result)
 	int s1 = sm_shifts[SC][1][1];
 	int s2 = sm_shifts[SC][2][1];
 	int s3 = sm_shifts[SC][3][1];
-	//Temporary Work Arrays
+	//Temporary Work Arrays, on the stack to keep the method reentrant
+	int t[MAX_BC];
+	int a[MAX_BC];
 	int i;
 	int tt;
 	int* pi = t;
@@ -1295,6 +1369,11 @@ void CRijndael::Encrypt(char const* in, char* result, size_t n, int iMode)
 {
 	if(false==m_bKeyInit)
 		throw exception(sm_szErrorMsg1);
+	if(CTR == iMode) //CTR mode, using the Chain as the counter
+	{
+		CtrStream(in, result, n);
+		return;
+	}
 	//n should be > 0 and multiple of m_blockSize
 	if(0==n || n%m_blockSize!=0)
 		throw exception(sm_szErrorMsg2);
@@ -1338,6 +1417,11 @@ void CRijndael::Decrypt(char const* in, char* result, size_t n, int iMode)
 {
 	if(false==m_bKeyInit)
 		throw exception(sm_szErrorMsg1);
+	if(CTR == iMode) //CTR mode, using the Chain as the counter
+	{
+		CtrStream(in, result, n);
+		return;
+	}
 	//n should be > 0 and multiple of m_blockSize
 	if(0==n || n%m_blockSize!=0)
 		throw exception(sm_szErrorMsg2);
@@ -1378,3 +1462,146 @@ void CRijndael::Decrypt(char const* in, char* result, size_t n, int iMode)
 	}
 }
 
+void CRijndael::EncryptBlocks(char const* in, char* result, size_t nBlocks) const
+{
+	if(false==m_bKeyInit)
+		throw exception(sm_szErrorMsg1);
+	if(DEFAULT_BLOCK_SIZE == m_blockSize && PATH_AESNI == m_iPath)
+	{
+		AesNiEncryptBlocks(in, result, nBlocks);
+		return;
+	}
+	for(size_t i=0; i<nBlocks; i++)
+		EncryptBlock(in + i*m_blockSize, result + i*m_blockSize);
+}
+
+namespace
+{
+	//Adds n to the 128-bit big-endian counter block
+	void AddCounter(char* counter, unsigned __int64 n)
+	{
+		for(int i=15; i>=0 && n!=0; i--)
+		{
+			n += (unsigned char)counter[i];
+			counter[i] = (char)n;
+			n >>= 8;
+		}
+	}
+
+	void IncrementCounter(char* counter)
+	{
+		for(int i=15; i>=0 && 0 == ++counter[i]; i--);
+	}
+
+	//result = in ^ stream, eight bytes at a time; result may be in
+	void XorStream(char const* in, char const* stream, char* result, size_t n)
+	{
+		size_t i = 0;
+		for(; i + 8 <= n; i += 8)
+		{
+			unsigned __int64 a, b;
+			memcpy(&a, in + i, 8);
+			memcpy(&b, stream + i, 8);
+			a ^= b;
+			memcpy(result + i, &a, 8);
+		}
+		for(; i<n; i++)
+			result[i] = in[i] ^ stream[i];
+	}
+}
+
+//Encrypts the counters of a batch of blocks in place, then xors the input with them.
+//The AES-NI path does whole blocks in registers.
+void CRijndael::CtrBlocks(char const* counter, unsigned __int64 iBlock, char const* in, char* result, size_t n) const
+{
+	enum { BATCH_BLOCKS=32 };
+	char next[DEFAULT_BLOCK_SIZE];
+	memcpy(next, counter, DEFAULT_BLOCK_SIZE);
+	AddCounter(next, iBlock);
+	if(PATH_AESNI == m_iPath)
+	{
+		size_t nBlocks = n / DEFAULT_BLOCK_SIZE;
+		AesNiCtrBlocks(next, in, result, nBlocks);
+		in += nBlocks * DEFAULT_BLOCK_SIZE;
+		result += nBlocks * DEFAULT_BLOCK_SIZE;
+		n -= nBlocks * DEFAULT_BLOCK_SIZE;
+	}
+
+	char stream[BATCH_BLOCKS * DEFAULT_BLOCK_SIZE];
+	while(n > 0)
+	{
+		size_t nBlocks = (n + DEFAULT_BLOCK_SIZE - 1) / DEFAULT_BLOCK_SIZE;
+		if(nBlocks > BATCH_BLOCKS)
+			nBlocks = BATCH_BLOCKS;
+		for(size_t i=0; i<nBlocks; i++)
+		{
+			memcpy(stream + i*DEFAULT_BLOCK_SIZE, next, DEFAULT_BLOCK_SIZE);
+			IncrementCounter(next);
+		}
+		EncryptBlocks(stream, stream, nBlocks);
+
+		size_t nBytes = nBlocks * DEFAULT_BLOCK_SIZE;
+		if(nBytes > n)
+			nBytes = n;
+		XorStream(in, stream, result, nBytes);
+		in += nBytes;
+		result += nBytes;
+		n -= nBytes;
+	}
+}
+
+void CRijndael::EncryptCtr(char const* counter, unsigned __int64 iBlock, char const* in, char* result, size_t n) const
+{
+	if(false==m_bKeyInit)
+		throw exception(sm_szErrorMsg1);
+	if(DEFAULT_BLOCK_SIZE != m_blockSize)
+		throw exception("CTR mode needs 128-bit blocks");
+	unsigned nThreads = std::thread::hardware_concurrency();
+	if(n < CTR_PARALLEL_SIZE || nThreads < 2)
+	{
+		CtrBlocks(counter, iBlock, in, result, n);
+		return;
+	}
+	//Every thread takes a whole number of blocks; this thread takes the last share.
+	size_t nShare = (n / nThreads + DEFAULT_BLOCK_SIZE - 1) / DEFAULT_BLOCK_SIZE * DEFAULT_BLOCK_SIZE;
+	std::vector<std::thread> threads;
+	threads.reserve(nThreads);
+	size_t offset = 0;
+	try
+	{
+		for(; n - offset > nShare; offset += nShare)
+			threads.push_back(std::thread(&CRijndael::CtrBlocks, this, counter, iBlock + offset / DEFAULT_BLOCK_SIZE, in + offset, result + offset, nShare));
+	}
+	catch(std::system_error const&)
+	{
+		//Out of threads; the rest is done on this thread.
+	}
+	CtrBlocks(counter, iBlock + offset / DEFAULT_BLOCK_SIZE, in + offset, result + offset, n - offset);
+	for(size_t i=0; i<threads.size(); i++)
+		threads[i].join();
+}
+
+void CRijndael::CtrStream(char const* in, char* result, size_t n)
+{
+	if(DEFAULT_BLOCK_SIZE != m_blockSize)
+		throw exception("CTR mode needs 128-bit blocks");
+	//The rest of the key stream block of the previous call
+	for(; n > 0 && m_ctrUsed < DEFAULT_BLOCK_SIZE; n--)
+		*(result++) = *(in++) ^ m_ctrStream[m_ctrUsed++];
+	size_t nWhole = n / DEFAULT_BLOCK_SIZE * DEFAULT_BLOCK_SIZE;
+	if(nWhole > 0)
+	{
+		EncryptCtr(m_chain, 0, in, result, nWhole);
+		AddCounter(m_chain, nWhole / DEFAULT_BLOCK_SIZE);
+		in += nWhole;
+		result += nWhole;
+		n -= nWhole;
+	}
+	if(n > 0)
+	{
+		EncryptBlock(m_chain, m_ctrStream);
+		IncrementCounter(m_chain);
+		for(m_ctrUsed = 0; n > 0; n--)
+			*(result++) = *(in++) ^ m_ctrStream[m_ctrUsed++];
+	}
+}
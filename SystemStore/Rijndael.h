@@ -32,7 +32,26 @@ public:
 	//plaintext block with the previous ciphertext block, and encrypting the resulting value.
 	//In CFB mode a ciphertext block is obtained by encrypting the previous ciphertext block
 	//and xoring the resulting value with the plaintext.
-	enum { ECB=0, CBC=1, CFB=2 };
+	//In CTR mode (128-bit blocks only) the chain is a counter block, incremented as a
+	//128-bit big-endian number for every block, and the plaintext is xored with the
+	//encrypted counters. Blocks do not depend on each other, so they are encrypted in
+	//batches and large inputs across threads. Encryption and decryption are the same,
+	//and n need not be a multiple of the block size: calls continue the key stream of
+	//the previous call until ResetChain, so data can be processed chunk by chunk.
+	enum { ECB=0, CBC=1, CFB=2, CTR=3 };
+
+	//Inputs to EncryptCtr of this many bytes or more are split across threads.
+	enum { CTR_PARALLEL_SIZE=1 << 20 };
+
+	//Block Paths
+	//Blocks of the default size (128-bit) are processed by the table lookups,
+	//by an SSSE3 implementation that looks up the S-box with byte shuffles, or
+	//by the AES-NI instructions. The two vector paths take no data dependent
+	//memory accesses, so unlike the tables they leak no timing through the
+	//cache. MakeKey selects AES-NI if the CPU supports it, else SSSE3 (which
+	//is slower than the tables), else the tables. All paths give identical
+	//results.
+	enum { PATH_TABLE=0, PATH_SSSE3=1, PATH_AESNI=2 };
 
 private:
 	enum { DEFAULT_BLOCK_SIZE=16 };
@@ -82,35 +101,63 @@ private:
 			*(buff++) ^= *(chain++);	
 	}
 
+	//The vector paths, implemented in RijndaelSimd.cpp. They use the round
+	//keys as bytes in m_KeBytes and m_KdBytes.
+	static bool HasSsse3();
+	static bool HasAesNi();
+	void AesNiEncryptBlocks(char const* in, char* result, size_t nBlocks) const;
+	void AesNiCtrBlocks(char* counter, char const* in, char* result, size_t nBlocks) const;
+	void Ssse3EncryptBlock(char const* in, char* result) const;
+	void Ssse3DecryptBlock(char const* in, char* result) const;
+	void AesNiEncryptBlock(char const* in, char* result) const;
+	void AesNiDecryptBlock(char const* in, char* result) const;
+
+	//CTR mode helpers
+	void CtrBlocks(char const* counter, unsigned __int64 iBlock, char const* in, char* result, size_t n) const;
+	void CtrStream(char const* in, char* result, size_t n);
+
 	//Convenience method to encrypt exactly one block of plaintext, assuming
 	//Rijndael's default block size (128-bit).
 	// in         - The plaintext
 	// result     - The ciphertext generated from a plaintext using the key
-	void DefEncryptBlock(char const* in, char* result);
+	void DefEncryptBlock(char const* in, char* result) const;
 
 	//Convenience method to decrypt exactly one block of plaintext, assuming
 	//Rijndael's default block size (128-bit).
 	// in         - The ciphertext.
 	// result     - The plaintext generated from a ciphertext using the session key.
-	void DefDecryptBlock(char const* in, char* result);
+	void DefDecryptBlock(char const* in, char* result) const;
 
 public:
+	//The block methods only read the key schedule, so after MakeKey one object
+	//can be shared by any number of threads encrypting or decrypting blocks.
+	//The whole-buffer methods below update the chain and are not reentrant.
+
 	//Encrypt exactly one block of plaintext.
 	// in           - The plaintext.
     // result       - The ciphertext generated from a plaintext using the key.
-    void EncryptBlock(char const* in, char* result);
+    void EncryptBlock(char const* in, char* result) const;
 	
 	//Decrypt exactly one block of ciphertext.
 	// in         - The ciphertext.
 	// result     - The plaintext generated from a ciphertext using the session key.
-	void DecryptBlock(char const* in, char* result);
+	void DecryptBlock(char const* in, char* result) const;
+
+	//Encrypt whole blocks independently (ECB), several blocks at a time on the
+	//AES-NI path.
+	void EncryptBlocks(char const* in, char* result, size_t nBlocks) const;
+
+	//CTR mode without the chain, for callers that keep their own position:
+	//processes n bytes starting at block iBlock of the key stream of counter.
+	//The method is reentrant. 128-bit blocks only.
+	void EncryptCtr(char const* counter, unsigned __int64 iBlock, char const* in, char* result, size_t n) const;
 
 	void Encrypt(char const* in, char* result, size_t n, int iMode=ECB);
 	
 	void Decrypt(char const* in, char* result, size_t n, int iMode=ECB);
 
 	//Get Key Length
-	int GetKeyLength()
+	int GetKeyLength() const
 	{
 		if(false==m_bKeyInit)
 			throw exception(sm_szErrorMsg1);
@@ -118,7 +165,7 @@ public:
 	}
 
 	//Block Size
-	int	GetBlockSize()
+	int	GetBlockSize() const
 	{
 		if(false==m_bKeyInit)
 			throw exception(sm_szErrorMsg1);
@@ -126,16 +173,31 @@ public:
 	}
 	
 	//Number of Rounds
-	int GetRounds()
+	int GetRounds() const
 	{
 		if(false==m_bKeyInit)
 			throw exception(sm_szErrorMsg1);
 		return m_iROUNDS;
 	}
 
+	//True if the CPU supports the block path.
+	static bool IsPathSupported(int iPath);
+
+	//Selects the block path, e.g. to compare the paths. Throws if the CPU does
+	//not support it, or if the block size is not the default.
+	void SetPath(int iPath);
+
+	int GetPath() const
+	{
+		if(false==m_bKeyInit)
+			throw exception(sm_szErrorMsg1);
+		return m_iPath;
+	}
+
 	void ResetChain()
 	{
 		memcpy(m_chain, m_chain0, m_blockSize);
+		m_ctrUsed = DEFAULT_BLOCK_SIZE;
 	}
 
 public:
@@ -176,13 +238,20 @@ private:
 	int	m_blockSize;
 	//Number of Rounds
 	int m_iROUNDS;
+	//Block Path
+	int m_iPath;
+	//Round keys of the default block size as bytes in block order, for the
+	//vector paths
+	unsigned char m_KeBytes[MAX_ROUNDS+1][DEFAULT_BLOCK_SIZE];
+	unsigned char m_KdBytes[MAX_ROUNDS+1][DEFAULT_BLOCK_SIZE];
 	//Chain Block
 	char m_chain0[MAX_BLOCK_SIZE];
 	char m_chain[MAX_BLOCK_SIZE];
-	//Auxiliary private use buffers
+	//Key stream of the current CTR block, and how much of it is used
+	char m_ctrStream[DEFAULT_BLOCK_SIZE];
+	int m_ctrUsed;
+	//Auxiliary private use buffer
 	int tk[MAX_KC];
-	int a[MAX_BC];
-	int t[MAX_BC];
 };
 
 #endif // __RIJNDAEL_H__
@@ -0,0 +1,193 @@
+//RijndaelSimd.cpp
+
+//The vector block paths of CRijndael for the default block size (128-bit).
+//The state is kept in one register as the 16 block bytes, column by column,
+//which is also the byte order of m_KeBytes and m_KdBytes.
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <intrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#include "Rijndael.h"
+
+namespace
+{
+	//Feature bits of CPUID leaf 1 in ECX
+	enum { CPUID_SSSE3=1 << 9, CPUID_AES=1 << 25 };
+
+	int CpuidFeatures()
+	{
+		int info[4];
+		__cpuid(info, 1);
+		return info[2];
+	}
+
+	__m128i Load(void const* p)
+	{
+		return _mm_loadu_si128(static_cast<__m128i const*>(p));
+	}
+
+	//Byte shuffles of ShiftRows, InvShiftRows, and of rotating every column
+	//up by one and by two rows
+	__m128i ShiftRowsMask()    { return _mm_setr_epi8(0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12, 1, 6, 11); }
+	__m128i InvShiftRowsMask() { return _mm_setr_epi8(0, 13, 10, 7, 4, 1, 14, 11, 8, 5, 2, 15, 12, 9, 6, 3); }
+	__m128i Rot1Mask()         { return _mm_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12); }
+	__m128i Rot2Mask()         { return _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13); }
+
+	//S-box lookup without memory accesses. Row h of the box (the outputs for
+	//inputs 16h to 16h+15) is held in a register and indexed by the low
+	//nibble of every byte with a shuffle; the high nibble selects the row.
+	__m128i SubBytes(__m128i x, __m128i const* rows)
+	{
+		__m128i const nibble = _mm_set1_epi8(0x0F);
+		__m128i const lo = _mm_and_si128(x, nibble);
+		__m128i const hi = _mm_and_si128(_mm_srli_epi16(x, 4), nibble);
+		__m128i result = _mm_setzero_si128();
+		for(int h=0; h<16; h++)
+		{
+			__m128i const select = _mm_cmpeq_epi8(hi, _mm_set1_epi8(static_cast<char>(h)));
+			result = _mm_or_si128(result, _mm_and_si128(select, _mm_shuffle_epi8(rows[h], lo)));
+		}
+		return result;
+	}
+
+	//Multiply every byte by 2 in GF(2^8)
+	__m128i XTime(__m128i x)
+	{
+		__m128i const carry = _mm_cmplt_epi8(x, _mm_setzero_si128());
+		return _mm_xor_si128(_mm_add_epi8(x, x), _mm_and_si128(carry, _mm_set1_epi8(0x1B)));
+	}
+
+	//b0 = 2a0 ^ 3a1 ^ a2 ^ a3 = 2(a0 ^ a1) ^ a1 ^ a2 ^ a3, and so on
+	__m128i MixColumns(__m128i x)
+	{
+		__m128i const rot1 = _mm_shuffle_epi8(x, Rot1Mask());
+		__m128i const rot2 = _mm_shuffle_epi8(x, Rot2Mask());
+		__m128i const rot3 = _mm_shuffle_epi8(rot2, Rot1Mask());
+		return _mm_xor_si128(_mm_xor_si128(XTime(_mm_xor_si128(x, rot1)), rot1), _mm_xor_si128(rot2, rot3));
+	}
+
+	//The inverse matrix is the forward one times (05 00 04 00), so
+	//a0 ^= 4(a0 ^ a2), a1 ^= 4(a1 ^ a3), ... before MixColumns.
+	__m128i InvMixColumns(__m128i x)
+	{
+		__m128i const rot2 = _mm_shuffle_epi8(x, Rot2Mask());
+		return MixColumns(_mm_xor_si128(x, XTime(XTime(_mm_xor_si128(x, rot2)))));
+	}
+}
+
+bool CRijndael::HasSsse3()
+{
+	return 0 != (CpuidFeatures() & CPUID_SSSE3);
+}
+
+bool CRijndael::HasAesNi()
+{
+	return 0 != (CpuidFeatures() & CPUID_AES) && HasSsse3();
+}
+
+void CRijndael::Ssse3EncryptBlock(char const* in, char* result) const
+{
+	__m128i rows[16];
+	for(int h=0; h<16; h++)
+		rows[h] = Load(sm_S + 16*h);
+	__m128i const shiftRows = ShiftRowsMask();
+	__m128i s = _mm_xor_si128(Load(in), Load(m_KeBytes[0]));
+	for(int r=1; r<m_iROUNDS; r++)
+		s = _mm_xor_si128(MixColumns(_mm_shuffle_epi8(SubBytes(s, rows), shiftRows)), Load(m_KeBytes[r]));
+	s = _mm_xor_si128(_mm_shuffle_epi8(SubBytes(s, rows), shiftRows), Load(m_KeBytes[m_iROUNDS]));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(result), s);
+}
+
+//The decryption round keys already have InvMixColumns applied (see MakeKey),
+//so every round ends with the key addition like the encryption rounds.
+void CRijndael::Ssse3DecryptBlock(char const* in, char* result) const
+{
+	__m128i rows[16];
+	for(int h=0; h<16; h++)
+		rows[h] = Load(sm_Si + 16*h);
+	__m128i const invShiftRows = InvShiftRowsMask();
+	__m128i s = _mm_xor_si128(Load(in), Load(m_KdBytes[0]));
+	for(int r=1; r<m_iROUNDS; r++)
+		s = _mm_xor_si128(InvMixColumns(SubBytes(_mm_shuffle_epi8(s, invShiftRows), rows)), Load(m_KdBytes[r]));
+	s = _mm_xor_si128(SubBytes(_mm_shuffle_epi8(s, invShiftRows), rows), Load(m_KdBytes[m_iROUNDS]));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(result), s);
+}
+
+void CRijndael::AesNiEncryptBlock(char const* in, char* result) const
+{
+	__m128i s = _mm_xor_si128(Load(in), Load(m_KeBytes[0]));
+	for(int r=1; r<m_iROUNDS; r++)
+		s = _mm_aesenc_si128(s, Load(m_KeBytes[r]));
+	s = _mm_aesenclast_si128(s, Load(m_KeBytes[m_iROUNDS]));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(result), s);
+}
+
+void CRijndael::AesNiDecryptBlock(char const* in, char* result) const
+{
+	__m128i s = _mm_xor_si128(Load(in), Load(m_KdBytes[0]));
+	for(int r=1; r<m_iROUNDS; r++)
+		s = _mm_aesdec_si128(s, Load(m_KdBytes[r]));
+	s = _mm_aesdeclast_si128(s, Load(m_KdBytes[m_iROUNDS]));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(result), s);
+}
+
+//Eight blocks at a time, so that the rounds of different blocks overlap in
+//the pipeline of the AES unit.
+void CRijndael::AesNiEncryptBlocks(char const* in, char* result, size_t nBlocks) const
+{
+	enum { LANES=8 };
+	__m128i rk[MAX_ROUNDS+1];
+	for(int r=0; r<=m_iROUNDS; r++)
+		rk[r] = Load(m_KeBytes[r]);
+	size_t i = 0;
+	for(; i + LANES <= nBlocks; i += LANES)
+	{
+		__m128i s[LANES];
+		for(int b=0; b<LANES; b++)
+			s[b] = _mm_xor_si128(Load(in + 16*(i+b)), rk[0]);
+		for(int r=1; r<m_iROUNDS; r++)
+			for(int b=0; b<LANES; b++)
+				s[b] = _mm_aesenc_si128(s[b], rk[r]);
+		for(int b=0; b<LANES; b++)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(result + 16*(i+b)), _mm_aesenclast_si128(s[b], rk[m_iROUNDS]));
+	}
+	for(; i<nBlocks; i++)
+		AesNiEncryptBlock(in + 16*i, result + 16*i);
+}
+
+//Counter mode over whole blocks with the counter in two integers, so that
+//neither the counter blocks nor the key stream go through memory. The
+//counter is advanced past the last block.
+void CRijndael::AesNiCtrBlocks(char* counter, char const* in, char* result, size_t nBlocks) const
+{
+	enum { LANES=8 };
+	__m128i const swap = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+	__m128i rk[MAX_ROUNDS+1];
+	for(int r=0; r<=m_iROUNDS; r++)
+		rk[r] = Load(m_KeBytes[r]);
+	//The big-endian counter as a little-endian 128-bit number
+	__m128i c = _mm_shuffle_epi8(Load(counter), swap);
+	unsigned __int64 lo, hi;
+	memcpy(&lo, reinterpret_cast<char const*>(&c), 8);
+	memcpy(&hi, reinterpret_cast<char const*>(&c) + 8, 8);
+	for(size_t i=0; i<nBlocks; )
+	{
+		size_t nLanes = std::min<size_t>(nBlocks - i, LANES);
+		__m128i s[LANES];
+		for(size_t b=0; b<nLanes; b++)
+		{
+			s[b] = _mm_xor_si128(_mm_shuffle_epi8(_mm_set_epi64x(static_cast<__int64>(hi), static_cast<__int64>(lo)), swap), rk[0]);
+			if(0 == ++lo)
+				++hi;
+		}
+		for(int r=1; r<m_iROUNDS; r++)
+			for(size_t b=0; b<nLanes; b++)
+				s[b] = _mm_aesenc_si128(s[b], rk[r]);
+		for(size_t b=0; b<nLanes; b++, i++)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(result + 16*i), _mm_xor_si128(Load(in + 16*i), _mm_aesenclast_si128(s[b], rk[m_iROUNDS])));
+	}
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(counter), _mm_shuffle_epi8(_mm_set_epi64x(static_cast<__int64>(hi), static_cast<__int64>(lo)), swap));
+}
@@ -0,0 +1,66 @@
+/*****************************************************************************
+ * Savepoint.cpp -- $Id$
+ *
+ * Purpose
+ *   Implements the Savepoint class.
+ *
+ * Indentation
+ *   Four characters. No tabs!
+ *
+ * Modifications
+ *   2026-10-17 (XSG) Created.
+ *
+ * Copyright (c) 2026 Xiao Shengguang.  All rights reserved.
+ ****************************************************************************/
+
+#include "Common/BaseDefs.h"
+#include "Savepoint.h"
+
+namespace AOI
+{
+namespace SystemStore
+{
+    // One name for every level. Savepoints end in the reverse order they
+    // began, and release and rollback go to the latest of the name.
+    #define SAVEPOINT_NAME  "system_store"
+
+    Savepoint::Savepoint(SQLite::Database &db)
+      : db(db), committed(false)
+    {
+        Begin(db);
+    }
+
+    Savepoint::~Savepoint()
+    {
+        if (!this->committed)
+            Rollback(this->db);
+    }
+
+    void Savepoint::Commit()
+    {
+        Release(this->db);
+        this->committed = true;
+    }
+
+    /*static*/void Savepoint::Begin(SQLite::Database &db)
+    {
+        db.exec(SL("savepoint " SAVEPOINT_NAME ";"));
+    }
+
+    /*static*/void Savepoint::Release(SQLite::Database &db)
+    {
+        db.exec(SL("release savepoint " SAVEPOINT_NAME ";"));
+    }
+
+    /*static*/void Savepoint::Rollback(SQLite::Database &db)
+    {
+        try
+        {
+            db.exec(SL("rollback to savepoint " SAVEPOINT_NAME "; release savepoint " SAVEPOINT_NAME ";"));
+        }
+        catch (SQLite::Exception &)
+        {
+        }
+    }
+}
+}
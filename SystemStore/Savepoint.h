@@ -0,0 +1,52 @@
+#ifndef AOI_SYSTEMSTORE_SAVEPOINT_H
+#define AOI_SYSTEMSTORE_SAVEPOINT_H
+/*****************************************************************************
+ * Savepoint.h -- $Id$
+ *
+ * Purpose
+ *   Declares the Savepoint class, a transaction that nests.
+ *
+ * Indentation
+ *   Four characters. No tabs!
+ *
+ * Modifications
+ *   2026-10-17 (XSG) Created.
+ *
+ * Copyright (c) 2026 Xiao Shengguang.  All rights reserved.
+ ****************************************************************************/
+
+#include "Common/BaseDefs.h"
+#include <SQLiteCpp/SQLiteCpp.h>
+
+namespace AOI
+{
+namespace SystemStore
+{
+    // Used as SQLite::Transaction, whose "begin" fails inside a transaction
+    // that is already open, e.g. that of a SystemStore::Batch. Outside of
+    // one, the savepoint starts a transaction and Commit commits it.
+    class Savepoint: private Uncopyable
+    {
+    public:
+        explicit Savepoint(SQLite::Database &db);
+
+        // Rolls back to the savepoint unless it was committed.
+        ~Savepoint();
+
+        void Commit();
+
+        // Undoes the writes since the savepoint and releases it. An error
+        // that already ended the transaction leaves nothing to undo, so it
+        // is not thrown again.
+        static void Rollback(SQLite::Database &db);
+
+        static void Begin  (SQLite::Database &db);
+        static void Release(SQLite::Database &db);
+
+    private:
+        SQLite::Database &db;
+        bool              committed;
+    };
+}
+}
+#endif/*AOI_SYSTEMSTORE_SAVEPOINT_H*/
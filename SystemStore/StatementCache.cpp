@@ -0,0 +1,121 @@
+/*****************************************************************************
+ * StatementCache.cpp -- $Id$
+ *
+ * Purpose
+ *   Implements the StatementCache class.
+ *
+ * Indentation
+ *   Four characters. No tabs!
+ *
+ * Modifications
+ *   2026-10-17 (XSG) Never handed out a statement that is still held.
+ *   2026-10-17 (XSG) Created.
+ *
+ * Copyright (c) 2026 Xiao Shengguang.  All rights reserved.
+ ****************************************************************************/
+
+#include "Common/BaseDefs.h"
+#include "StatementCache.h"
+#include "Constants.h"
+#include <chrono>
+#include <map>
+
+namespace AOI
+{
+namespace SystemStore
+{
+    namespace
+    {
+        // One cache per connection. The connection is kept alive by its
+        // cache, so an expired entry is the only way an address is reused.
+        std::mutex                                                  registryMutex;
+        std::map<SQLite::Database *, std::weak_ptr<StatementCache>> registry;
+    }
+
+    StatementCache::StatementCache(DatabasePtr const &db, size_t capacity)
+      : db(db), capacity(capacity)
+    {
+        this->counters.hits                = 0;
+        this->counters.misses              = 0;
+        this->counters.evictions           = 0;
+        this->counters.compileMicroseconds = 0;
+    }
+
+    /*static*/StatementCachePtr StatementCache::For(DatabasePtr const &db)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto it = registry.begin(); it != registry.end(); )
+        {
+            if (it->second.expired())
+                it = registry.erase(it);
+            else
+                ++it;
+        }
+
+        std::weak_ptr<StatementCache> &entry = registry[db.get()];
+        StatementCachePtr cache = entry.lock();
+        if (!cache)
+        {
+            cache = std::make_shared<StatementCache>(db, STATEMENT_CACHE_CAPACITY);
+            entry = cache;
+        }
+        return cache;
+    }
+
+    StatementPtr StatementCache::Acquire(String const &sql)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        auto const found = this->index.find(sql);
+        bool const cached = found != this->index.end();
+        // Only the cache itself may hold a statement that is handed out.
+        if (cached && found->second->second.use_count() == 1)
+        {
+            this->entries.splice(this->entries.begin(), this->entries, found->second);
+            ++this->counters.hits;
+
+            StatementPtr const &statement = found->second->second;
+            try
+            {
+                statement->reset();
+            }
+            catch (SQLite::Exception &)
+            {
+                // The error of the last step, which its caller has had.
+            }
+            statement->clearBindings();
+            return statement;
+        }
+
+        ++this->counters.misses;
+        auto const start = std::chrono::steady_clock::now();
+        StatementPtr statement = std::make_shared<SQLite::Statement>(*this->db.get(), sql);
+        this->counters.compileMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        if (cached)
+            return statement;
+
+        this->entries.push_front(Entry(sql, statement));
+        this->index[sql] = this->entries.begin();
+        if (this->entries.size() > this->capacity)
+        {
+            this->index.erase(this->entries.back().first);
+            this->entries.pop_back();
+            ++this->counters.evictions;
+        }
+        return statement;
+    }
+
+    void StatementCache::Clear()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->index.clear();
+        this->entries.clear();
+    }
+
+    StatementCache::Counters StatementCache::GetCounters() const
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->counters;
+    }
+}
+}
@@ -0,0 +1,74 @@
+#ifndef AOI_SYSTEMSTORE_STATEMENT_CACHE_H
+#define AOI_SYSTEMSTORE_STATEMENT_CACHE_H
+/*****************************************************************************
+ * StatementCache.h -- $Id$
+ *
+ * Purpose
+ *   Declares the StatementCache class, which keeps the prepared statements
+ *   of one connection for reuse.
+ *
+ * Indentation
+ *   Four characters. No tabs!
+ *
+ * Modifications
+ *   2026-10-17 (XSG) Never handed out a statement that is still held.
+ *   2026-10-17 (XSG) Created.
+ *
+ * Copyright (c) 2026 Xiao Shengguang.  All rights reserved.
+ ****************************************************************************/
+
+#include "Table.h"
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace AOI
+{
+namespace SystemStore
+{
+    // Statements are keyed by their SQL, which the Table builders derive
+    // from the call shape (table, fields, keys and order), so the same
+    // shape is compiled once per connection. The least recently used
+    // statement is dropped when the cache is full; a table that still
+    // holds it keeps using it.
+    class StatementCache: private Uncopyable
+    {
+    public:
+        struct Counters
+        {
+            Int64 hits;
+            Int64 misses;
+            Int64 evictions;
+            Int64 compileMicroseconds;
+        };
+
+        StatementCache(DatabasePtr const &db, size_t capacity);
+
+        // The cache of the connection, made on first use.
+        static StatementCachePtr For(DatabasePtr const &db);
+
+        // Returns the statement for the SQL, reset and with its bindings
+        // cleared. A cached statement that is still held elsewhere (kept
+        // by a table, or in the middle of its rows, e.g. when a visitor
+        // starts the same scan) is left alone and a new one is compiled
+        // for the caller, without being cached.
+        StatementPtr Acquire(String const &sql);
+
+        void     Clear();
+        Counters GetCounters() const;
+
+    private:
+        typedef std::pair<String, StatementPtr> Entry;
+        typedef std::list<Entry>                EntryList;
+
+        // Declared first, so the connection outlives the statements.
+        DatabasePtr                                     db;
+        size_t                                          capacity;
+        std::mutex mutable                              mutex;
+        EntryList                                       entries;    // most recently used first
+        std::unordered_map<String, EntryList::iterator> index;
+        Counters                                        counters;
+    };
+}
+}
+#endif/*AOI_SYSTEMSTORE_STATEMENT_CACHE_H*/
@@ -0,0 +1,94 @@
+#ifndef AOI_SYSTEMSTORE_STATIC_TABLE_H
+#define AOI_SYSTEMSTORE_STATIC_TABLE_H
+/*****************************************************************************
+ * StaticTable.h -- $Id$
+ *
+ * Purpose
+ *   Declares the StaticTable class template, the base of tables whose
+ *   layout is known at compile time.
+ *
+ * Indentation
+ *   Four characters. No tabs!
+ *
+ * Modifications
+ *   2026-10-17 (XSG) Added the Int64 Update, befriended InsertBatch.
+ *   2026-10-17 (XSG) Allowed the field table in the table's source file.
+ *   2026-10-17 (XSG) Created.
+ *
+ * Copyright (c) 2026 Xiao Shengguang.  All rights reserved.
+ ****************************************************************************/
+
+#include "Table.h"
+
+namespace AOI
+{
+namespace SystemStore
+{
+    // Derived describes its fields with
+    //
+    //     static FieldEntry const &StaticGetField(int index);
+    //
+    // whose array is a constant, so that a check on the bits of a field
+    // known at the call folds away. It is defined inline in the header, or
+    // in the table's own source file when the names are literals private to
+    // it; the binders are only called there. The virtual field methods of
+    // Table are implemented from it for the generic code, e.g. Create.
+    // Base is IdBasedTable, or a class derived from it.
+    template <class Derived, class Base>
+    class StaticTable: public Base
+    {
+        template <class TableT> friend class InsertBatch;
+
+    protected:
+        explicit StaticTable(DatabasePtr const &database): Base(database) {}
+
+    public:
+        virtual ~StaticTable() {}
+
+        /********
+        * Table *
+        ********/
+        virtual int    GetFieldCount()         const override { return Derived::COUNT_; }
+        virtual String GetFieldName(int index) const override { return GetField(index).fieldName; }
+        virtual int    GetFieldBits(int index) const override { return GetField(index).fieldBits; }
+        virtual String GetFieldSql (int index) const override { return GetField(index).fieldSql; }
+
+    protected:
+        using Base::Bind;
+
+        // As Table::Bind for Int64 values being inserted or updated, with
+        // the field bits read without a virtual call.
+        void Bind(StatementPtr const &command, Int32 index, Int64 value, int fieldIndex) const
+        {
+            int const bits = GetField(fieldIndex).fieldBits;
+            if (value != Table::ID_NULL || 0 == (bits & Table::BIT_INTID))
+                command->bind(index, value);
+            else if (0 != (bits & Table::BIT_NULLOK))
+                command->bind(index);
+            else
+                Base::Bind(command, index, value, fieldIndex);  // throws
+        }
+
+        using Base::Update;
+
+        // As IdBasedTable::Update for Int64 values, with the binder above.
+        void Update(Int64 id, StatementPtr &update, int fieldIndex, Int64 value)
+        {
+            if (!update)
+                update = this->BuildUpdateCommand(fieldIndex, this->GetFieldIndexOfId());
+
+            Bind(update, 1, value, fieldIndex);
+            Bind(update, 2, id, Table::ID_SAFE);
+            this->Exec(update);
+        }
+
+    private:
+        static Table::FieldEntry const &GetField(int index)
+        {
+            assert(index >= 0 && index < Derived::COUNT_ && "Field index out of range in StaticTable::GetField.");
+            return Derived::StaticGetField(index);
+        }
+    };
+}
+}
+#endif/*AOI_SYSTEMSTORE_STATIC_TABLE_H*/
@@ -1,13 +1,33 @@
 #include "Common/BaseDefs.h"
 #include <SQLiteCpp/SQLiteCpp.h>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <system_error>
+#include <thread>
+#include <SQLite3/sqlite3.h>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <openssl/rand.h>
 
 #define API_CALL  __declspec(dllexport)
 #include "SystemStore.h"
 
 #include "UserTable.h"
 #include "ParamTable.h"
+#include "ParamCache.h"
+#include "ParamHistoryTable.h"
+#include "CalibrationTable.h"
+#include "CalibrationCodec.h"
 #include "Constants.h"
 #include "Rijndael.h"
+#include "RestrictionSet.h"
+#include "StatementCache.h"
+#include "Savepoint.h"
 
 namespace AOI
 {
@@ -16,11 +36,405 @@ namespace SystemStore
 
 struct SystemStore::Impl { // as before
     DatabasePtr     db;
+    RestrictionProfileTablePtr restrictionProfileTable;
     UserTablePtr    userTable;
     ParamTablePtr   paramTable;
+    ParamHistoryTablePtr paramHistoryTable;
+    CalibrationTablePtr calibrationTable;
+    // Keyed once in _Init. Only its const block methods are used after
+    // that, so concurrent logins share the key schedule without locking.
+    CRijndael       cipher;
     String          errMsg;
+    // The user of the last successful login, recorded in the param history.
+    String          userName;
+
+    // Read-through cache of param values, keyed by param name. Entries are
+    // invalidated when the param is written through this store, and, with
+    // SHARED_PARAMS, the whole cache when another connection has written
+    // since the data version was read.
+    ParamCache      paramCache;
+    bool            watchDataVersion;
+    Int64           paramCacheDataVersion;
+    Int64           paramCacheHits;
+    Int64           paramCacheMisses;
+
+    // Param versions. The global version is only bumped under the mutex,
+    // but it is atomic so that polling it needs no lock.
+    struct Subscription
+    {
+        std::unordered_set<String> names;
+        ParamChangeCallback        callback;
+    };
+
+    std::atomic<Int64>                  paramsVersion;
+    mutable std::mutex                  versionMutex;
+    std::condition_variable             versionChanged;
+    std::unordered_map<String, Int64>   paramVersions;
+    std::map<Int64, Subscription>       subscriptions;
+    Int64                               lastSubscriptionId;
+
+    // Login sessions, keyed by token. A session expires when it has not
+    // been validated for the timeout.
+    struct Session
+    {
+        Int64                                   userId;
+        String                                  userName;
+        std::chrono::steady_clock::time_point   expiry;
+    };
+
+    std::mutex                              sessionMutex;
+    std::unordered_map<String, Session>     sessions;
+    std::chrono::milliseconds               sessionTimeout;
+
+    // Compiled restriction documents, keyed by user Id, and the key
+    // handles that index their bits. The generation counts the times
+    // compiled documents were dropped.
+    std::mutex                                  restrictionMutex;
+    RestrictionKeys                             restrictionKeys;
+    std::unordered_map<Int64, RestrictionSet>   restrictions;
+    Int64                                       restrictionsGeneration;
+
+    // The open caller batches, and the params changed in them, which are
+    // notified when the outermost one commits.
+    Int32           batchDepth;
+    StringVector    batchChanged;
+
+    Impl() : watchDataVersion(false), paramCacheDataVersion(-1), paramCacheHits(0), paramCacheMisses(0), paramsVersion(0), lastSubscriptionId(0), sessionTimeout(SESSION_TIMEOUT_MS), restrictionsGeneration(0), batchDepth(0) {}
+
+    bool StartSession(Int64 userId, const String &userName, String &token);
+    void EndSessionsOf(const String &userName);
+
+    void PreloadParams();
+    // Throws if the param does not exist.
+    void SelectParam(const String &name, ParamValue &value);
+    void InvalidateParam(const String &name);
+
+    void ParamsChanged(const StringVector &names);
+    void ClearCaches();
+    Int64 LatestParamVersion(const StringVector &names) const;
+
+    static Int64 Now();
+    template <class T> void InsertParam(const String &name, const T &value);
+    template <class T> bool UpdateParam(const String &name, const T &value);
+    template <class T> bool UpsertParam(const String &name, const T &value);
+
+    template <class T> void SelectParams(const StringVector &names, std::vector<T> &values);
+    template <class T> void SelectParamsUnder(const String &prefix, std::vector<std::pair<String, T>> &params);
+    template <class T> void UpsertParams(const std::vector<std::pair<String, T>> &params);
+    template <class T> Int64 InsertCalibration(const String &name, const std::vector<T> &values);
+    template <class T> void SelectCalibration(const String &name, Int64 &version, std::vector<T> &values);
+    void SetErrMsg(const SQLite::Exception &e);
 };
 
+void SystemStore::Impl::PreloadParams()
+{
+    // Sized up front so the scan never rehashes.
+    paramCache.Clear();
+    paramCacheDataVersion = paramTable->SelectDataVersion();
+    paramCache.Reserve(static_cast<size_t>(paramTable->SelectCount()));
+    paramTable->SelectAll([this](char const *name, size_t length, const ParamValue &value)
+    {
+        paramCache.Insert(name, length, value);
+        return true;
+    });
+}
+
+void SystemStore::Impl::SelectParam(const String &name, ParamValue &value)
+{
+    // Only a shared store pays a pragma per read, so that an edit by
+    // another store or process is seen on the next read.
+    if ( watchDataVersion )
+    {
+        Int64 const dataVersion = paramTable->SelectDataVersion();
+        if ( dataVersion != paramCacheDataVersion )
+        {
+            paramCache.Clear();
+            paramCacheDataVersion = dataVersion;
+        }
+    }
+
+    ParamValue const *cached = paramCache.Find(name);
+    if ( cached != nullptr )
+    {
+        ++ paramCacheHits;
+        value = *cached;
+        return;
+    }
+
+    // Even after a preload, a param added by another process is read
+    // from the database.
+    ++ paramCacheMisses;
+    if ( ! paramTable->SelectValue(name, value) )
+        throw SQLite::Exception("Param " + name + " does not exist.");
+    paramCache.Insert(name, value);
+}
+
+void SystemStore::Impl::InvalidateParam(const String &name)
+{
+    paramCache.Erase(name);
+}
+
+void SystemStore::Impl::ParamsChanged(const StringVector &names)
+{
+    if ( batchDepth > 0 )
+    {
+        batchChanged.insert(batchChanged.end(), names.begin(), names.end());
+        return;
+    }
+
+    // A batch commits atomically, so all of its params share one version.
+    std::vector<std::pair<ParamChangeCallback, String>> calls;
+    Int64 version = 0;
+    {
+        std::lock_guard<std::mutex> lock(versionMutex);
+        version = paramsVersion + 1;
+        for ( auto const &name : names )
+        {
+            paramVersions[name] = version;
+            for ( auto const &subscription : subscriptions )
+                if ( subscription.second.names.empty() || subscription.second.names.count(name) > 0 )
+                    calls.emplace_back(subscription.second.callback, name);
+        }
+        paramsVersion = version;
+    }
+    versionChanged.notify_all();
+
+    // Outside the lock, so a callback may read versions or unsubscribe.
+    for ( auto const &call : calls )
+        call.first(call.second, version);
+}
+
+// After a rollback, the caches may hold values read inside it.
+void SystemStore::Impl::ClearCaches()
+{
+    paramCache.Clear();
+    std::lock_guard<std::mutex> lock(restrictionMutex);
+    restrictions.clear();
+    ++ restrictionsGeneration;
+}
+
+Int64 SystemStore::Impl::LatestParamVersion(const StringVector &names) const
+{
+    if ( names.empty() )
+        return paramsVersion;
+
+    Int64 version = 0;
+    for ( auto const &name : names )
+    {
+        auto it = paramVersions.find(name);
+        if ( it != paramVersions.end() )
+            version = std::max(version, it->second);
+    }
+    return version;
+}
+
+namespace
+{
+    void FromParamValue(const ParamValue &paramValue, Int32  &value) { value = paramValue.AsInt32();  }
+    void FromParamValue(const ParamValue &paramValue, double &value) { value = paramValue.AsDouble(); }
+}
+
+/*static*/ Int64 SystemStore::Impl::Now()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Each write logs the change first, while the old value can still be read,
+// in the same transaction as the write, so the history and the param
+// table always agree. This costs no extra journal sync.
+template <class T> void SystemStore::Impl::InsertParam(const String &name, const T &value)
+{
+    Savepoint savepoint(*db);
+    InvalidateParam(name);
+    paramHistoryTable->Insert(paramHistoryTable->SelectLastSeq() + 1, name, Now(), userName, value);
+    paramTable->Insert(name, value);
+    savepoint.Commit();
+    ParamsChanged(StringVector(1, name));
+}
+
+template <class T> bool SystemStore::Impl::UpdateParam(const String &name, const T &value)
+{
+    Savepoint savepoint(*db);
+    InvalidateParam(name);
+    paramHistoryTable->Insert(paramHistoryTable->SelectLastSeq() + 1, name, Now(), userName, value);
+    if ( ! paramTable->UpdateValue(name, value) )
+        return false;   // The param does not exist, the rollback drops the log row.
+    savepoint.Commit();
+    ParamsChanged(StringVector(1, name));
+    return true;
+}
+
+template <class T> bool SystemStore::Impl::UpsertParam(const String &name, const T &value)
+{
+    Savepoint savepoint(*db);
+    InvalidateParam(name);
+    paramHistoryTable->Insert(paramHistoryTable->SelectLastSeq() + 1, name, Now(), userName, value);
+    bool created = paramTable->Upsert(name, value);
+    savepoint.Commit();
+    ParamsChanged(StringVector(1, name));
+    return created;
+}
+
+template <class T> void SystemStore::Impl::SelectParams(const StringVector &names, std::vector<T> &values)
+{
+    values.resize(names.size());
+
+    // One read transaction for the whole batch, the params missing from
+    // the cache share the prepared select statement of the param table.
+    Savepoint savepoint(*db);
+    ParamValue paramValue;
+    for ( size_t i = 0; i < names.size(); ++ i )
+    {
+        SelectParam(names[i], paramValue);
+        if ( paramValue.type == Enum::ParamType::BLOB )
+            throw SQLite::Exception("Param " + names[i] + " is binary.");
+        FromParamValue(paramValue, values[i]);
+    }
+    savepoint.Commit();
+}
+
+template <class T> void SystemStore::Impl::SelectParamsUnder(const String &prefix, std::vector<std::pair<String, T>> &params)
+{
+    params.clear();
+    paramTable->SelectUnder(prefix, [&params](char const *name, size_t length, const ParamValue &paramValue)
+    {
+        if ( paramValue.type == Enum::ParamType::BLOB )
+            return true;
+        params.emplace_back(String(name, length), T());
+        FromParamValue(paramValue, params.back().second);
+        return true;
+    });
+}
+
+template <class T> void SystemStore::Impl::UpsertParams(const std::vector<std::pair<String, T>> &params)
+{
+    // One write transaction (and one journal sync) for the whole batch,
+    // every param is a bind and a step of the cached update statement, plus
+    // one of the cached insert statement for a param that does not exist.
+    Savepoint savepoint(*db);
+    Int64 const time = Now();
+    Int64 seq = paramHistoryTable->SelectLastSeq();
+    StringVector names;
+    names.reserve(params.size());
+    for ( auto const &param : params )
+    {
+        InvalidateParam(param.first);
+        paramHistoryTable->Insert(++ seq, param.first, time, userName, param.second);
+        paramTable->Upsert(param.first, param.second);
+        names.push_back(param.first);
+    }
+    savepoint.Commit();
+    ParamsChanged(names);
+}
+
+namespace
+{
+    // The token stands in for the password, so its bits come from the
+    // cryptographic generator of OpenSSL (libeay32 is already linked)
+    // rather than the seeded generator of GetRandomUuid. It is written as a
+    // version 4 UUID.
+    bool NewSessionToken(String &token)
+    {
+        boost::uuids::uuid uuid;
+        if ( RAND_bytes(uuid.data, static_cast<int>(uuid.size())) != 1 )
+            return false;
+        uuid.data[6] = static_cast<boost::uuids::uuid::value_type>((uuid.data[6] & 0x0F) | 0x40);
+        uuid.data[8] = static_cast<boost::uuids::uuid::value_type>((uuid.data[8] & 0x3F) | 0x80);
+        token = boost::uuids::to_string(uuid);
+        return true;
+    }
+}
+
+bool SystemStore::Impl::StartSession(Int64 userId, const String &userName, String &token)
+{
+    if ( ! NewSessionToken(token) )
+    {
+        token.clear();
+        return false;
+    }
+    auto const now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    // Logins are rare, so expired sessions are dropped here rather than
+    // on a timer.
+    for ( auto it = sessions.begin(); it != sessions.end(); )
+    {
+        if ( it->second.expiry <= now )
+            it = sessions.erase(it);
+        else
+            ++ it;
+    }
+
+    Session &session = sessions[token];
+    session.userId   = userId;
+    session.userName = userName;
+    session.expiry   = now + sessionTimeout;
+    return true;
+}
+
+void SystemStore::Impl::EndSessionsOf(const String &userName)
+{
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    for ( auto it = sessions.begin(); it != sessions.end(); )
+    {
+        if ( it->second.userName == userName )
+            it = sessions.erase(it);
+        else
+            ++ it;
+    }
+}
+
+// The array is coded before the transaction starts, so the write lock is
+// only held for the insert.
+template <class T> Int64 SystemStore::Impl::InsertCalibration(const String &name, const std::vector<T> &values)
+{
+    Binary data;
+    CalibrationEncoder encoder(sizeof(T), data);
+    encoder.Write(values.data(), values.size());
+    encoder.Finish();
+
+    Savepoint savepoint(*db);
+    Int64 const version = calibrationTable->SelectLatestVersion(name) + 1;
+    Enum::ElementType const elementType = (sizeof(T) == sizeof(float)) ? Enum::ElementType::FLOAT32 : Enum::ElementType::FLOAT64;
+    calibrationTable->Insert(name, version, Now(), elementType, static_cast<Int64>(values.size()), data);
+    savepoint.Commit();
+    return version;
+}
+
+// Decodes straight from SQLite's buffer into values, so the coded array is
+// never copied. Version 0 selects the latest version and is set to it.
+template <class T> void SystemStore::Impl::SelectCalibration(const String &name, Int64 &version, std::vector<T> &values)
+{
+    Enum::ElementType const elementType = (sizeof(T) == sizeof(float)) ? Enum::ElementType::FLOAT32 : Enum::ElementType::FLOAT64;
+    bool const found = calibrationTable->SelectData(name, version, [&](Int64 foundVersion, Enum::ElementType foundType, Int64 count, void const *data, size_t size)
+    {
+        if ( foundType != elementType )
+            throw SQLite::Exception("Calibration " + name + " has another element type.");
+
+        values.resize(static_cast<size_t>(count));
+        CalibrationDecoder decoder(sizeof(T), data, size);
+        if ( decoder.Read(values.data(), values.size()) != values.size() )
+            throw SQLite::Exception("Corrupt calibration data.");
+        version = foundVersion;
+    });
+    if ( !found )
+        throw SQLite::Exception(( version == 0 ) ? "Calibration " + name + " does not exist."
+                                                 : "Calibration " + name + " has no version " + std::to_string(version) + ".");
+}
+
+namespace
+{
+    String ErrorText(const SQLite::Exception &e)
+    {
+        return ( e.getErrorCode() != SQLite::UNKNOWN_ERROR ) ? String(e.getErrorStr()) : String(e.what());
+    }
+}
+
+void SystemStore::Impl::SetErrMsg(const SQLite::Exception &e)
+{
+    errMsg = ErrorText(e);
+}
+
 SystemStore::SystemStore():_pImpl(std::make_unique<Impl>())
 {
     // Open a database file in create/write mode
@@ -28,19 +442,44 @@ SystemStore::SystemStore():_pImpl(std::make_unique<Impl>())
     _Init();
 }
 
+SystemStore::SystemStore(Int32 options):SystemStore()
+{
+    _pImpl->watchDataVersion = ( options & SHARED_PARAMS ) != 0;
+    if ( options & PRELOAD_PARAMS )
+        _pImpl->PreloadParams();
+}
+
 SystemStore::~SystemStore()
 {
 }
 
 Int32 SystemStore::_Init()
 {
-    _pImpl->userTable = std::make_shared<UserTable>( _pImpl->db );
+    _pImpl->cipher.MakeKey(ENCRYPT_KEY, CRijndael::sm_chain0, CIPHER_BLOCK_SIZE, CIPHER_BLOCK_SIZE);
+
+    _pImpl->restrictionProfileTable = std::make_shared<RestrictionProfileTable>( _pImpl->db );
+    if ( ! _pImpl->db->tableExists ( RestrictionProfileTable::StaticGetTableName() ) )
+        _pImpl->restrictionProfileTable->Create();
+
+    _pImpl->userTable = std::make_shared<UserTable>( _pImpl->db, _pImpl->restrictionProfileTable );
     if ( !_pImpl->db->tableExists ( UserTable::StaticGetTableName() ) )
         _pImpl->userTable->Create();
+    else
+        _pImpl->userTable->Migrate();
 
     _pImpl->paramTable = std::make_shared<ParamTable>( _pImpl->db );
     if ( ! _pImpl->db->tableExists ( ParamTable::StaticGetTableName() ) )
         _pImpl->paramTable->Create();
+    else
+        _pImpl->paramTable->Migrate();
+
+    _pImpl->paramHistoryTable = std::make_shared<ParamHistoryTable>( _pImpl->db, PARAM_HISTORY_CAPACITY );
+    if ( ! _pImpl->db->tableExists ( ParamHistoryTable::StaticGetTableName() ) )
+        _pImpl->paramHistoryTable->Create();
+
+    _pImpl->calibrationTable = std::make_shared<CalibrationTable>( _pImpl->db );
+    if ( ! _pImpl->db->tableExists ( CalibrationTable::StaticGetTableName() ) )
+        _pImpl->calibrationTable->Create();
     return 0;
 }
 
@@ -68,11 +507,77 @@ int SystemStore::AddUser(const String &name, const String &password, UserRole ro
     }
 }
 
+int SystemStore::ImportUsers(const UserImportVector &users, StringVector &errors)
+{
+    errors.assign(users.size(), String());
+
+    // The cipher is only read, so each thread encrypts a share of the
+    // passwords; this thread takes the last one.
+    StringVector passwords(users.size());
+    auto encrypt = [&](size_t begin, size_t end)
+    {
+        for ( size_t i = begin; i < end; ++ i )
+            passwords[i] = _Encrypt(users[i].password);
+    };
+
+    size_t nThreads = ( users.size() < PARALLEL_ENCRYPT_COUNT ) ? 1 : std::max(1u, std::thread::hardware_concurrency());
+    size_t nShare = ( users.size() + nThreads - 1 ) / nThreads;
+    std::vector<std::thread> threads;
+    threads.reserve(nThreads);
+    size_t begin = 0;
+    try
+    {
+        for ( ; users.size() - begin > nShare; begin += nShare )
+            threads.push_back(std::thread(encrypt, begin, begin + nShare));
+    }
+    catch(std::system_error const &)
+    {
+        // Out of threads, the rest is done on this thread.
+    }
+    encrypt(begin, users.size());
+    for ( auto &thread : threads )
+        thread.join();
+
+    try
+    {
+        // The table takes the users field by field, a multi-row insert
+        // at a time.
+        StringVector names(users.size()), restrictions(users.size());
+        Int32Vector roles(users.size());
+        for ( size_t i = 0; i < users.size(); ++ i )
+        {
+            names[i]        = users[i].name;
+            roles[i]        = ToInt32(users[i].role);
+            restrictions[i] = users[i].restriction;
+        }
+
+        size_t nRejected = 0;
+        Savepoint savepoint(*_pImpl->db);
+        _pImpl->userTable->Import(users.size(), names.data(), passwords.data(), roles.data(), restrictions.data(), [&](size_t i, const SQLite::Exception &e)
+        {
+            errors[i] = ErrorText(e);
+            ++ nRejected;
+        });
+        savepoint.Commit();
+
+        if ( nRejected == 0 )
+            return OK;
+        _pImpl->errMsg = std::to_string(nRejected) + " of " + std::to_string(users.size()) + " users were not imported.";
+        return NOK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
 int SystemStore::UserLogin(const String &name, const String &password, Int64 &Id)
 {
     try
     {
         Id = _pImpl->userTable->SelectUser(name, _Encrypt ( password ) );
+        _pImpl->userName = name;
         return OK;
     }
     catch(SQLite::Exception &e)
@@ -86,12 +591,75 @@ int SystemStore::UserLogin(const String &name, const String &password, Int64 &Id
     }
 }
 
+int SystemStore::UserLogin(const String &name, const String &password, Int64 &Id, String &sessionToken)
+{
+    sessionToken.clear();
+    if ( UserLogin(name, password, Id) != OK )
+        return NOK;
+
+    if ( ! _pImpl->StartSession(Id, name, sessionToken) )
+    {
+        _pImpl->errMsg = "Failed to generate a session token.";
+        return NOK;
+    }
+    return OK;
+}
+
+int SystemStore::ValidateSession(const String &sessionToken, Int64 &Id)
+{
+    String userName;
+    return ValidateSession(sessionToken, Id, userName);
+}
+
+int SystemStore::ValidateSession(const String &sessionToken, Int64 &Id, String &userName)
+{
+    auto const now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(_pImpl->sessionMutex);
+    auto it = _pImpl->sessions.find(sessionToken);
+    if ( it == _pImpl->sessions.end() )
+    {
+        _pImpl->errMsg = "Session is not valid.";
+        Id = 0;
+        return NOK;
+    }
+    if ( it->second.expiry <= now )
+    {
+        _pImpl->sessions.erase(it);
+        _pImpl->errMsg = "Session has expired.";
+        Id = 0;
+        return NOK;
+    }
+
+    it->second.expiry = now + _pImpl->sessionTimeout;
+    Id = it->second.userId;
+    userName = it->second.userName;
+    return OK;
+}
+
+void SystemStore::EndSession(const String &sessionToken)
+{
+    std::lock_guard<std::mutex> lock(_pImpl->sessionMutex);
+    _pImpl->sessions.erase(sessionToken);
+}
+
+void SystemStore::SetSessionTimeout(Int32 timeoutMs)
+{
+    std::lock_guard<std::mutex> lock(_pImpl->sessionMutex);
+    _pImpl->sessionTimeout = std::chrono::milliseconds(timeoutMs);
+}
+
 int SystemStore::UpdatePassword(const String &name, const String &password, const String &passwordNew)
 {
     try
     {
-        Int64 Id = _pImpl->userTable->SelectUser(name, _Encrypt ( password ) );
-        _pImpl->userTable->UpdatePassword(Id, _Encrypt ( passwordNew ) );
+        // The old password is checked by the update itself, so a wrong one
+        // is an unchanged row, not an exception.
+        if ( ! _pImpl->userTable->UpdatePassword(name, _Encrypt ( password ), _Encrypt ( passwordNew ) ) )
+        {
+            _pImpl->errMsg = "Wrong user name or password.";
+            return NOK;
+        }
+        _pImpl->EndSessionsOf(name);
         return OK;
     }
     catch(SQLite::Exception &e)
@@ -108,10 +676,11 @@ int SystemStore::GetUserRoleAndRestriction(Int64 Id, UserRole&role, String &rest
 {
     try
     {
-        Int32 n32Role;
-        _pImpl->userTable->SelectRole(Id, n32Role);
-        role = static_cast<UserRole>(n32Role);
-        _pImpl->userTable->SelectRestriction(Id, restriction);
+        UserRow row;
+        if ( ! _pImpl->userTable->SelectUserRow(Id, row) )
+            throw SQLite::Exception("User " + std::to_string(Id) + " does not exist.");
+        role = static_cast<UserRole>(row.role);
+        restriction = std::move(row.restriction);
         return OK;
     }
     catch(SQLite::Exception &e)
@@ -124,107 +693,709 @@ int SystemStore::GetUserRoleAndRestriction(Int64 Id, UserRole&role, String &rest
     }
 }
 
-String SystemStore::_Encrypt(const String &strTarget)
+namespace
+{
+    void ToUserInfo(UserRow &row, UserInfo &user)
+    {
+        user.Id = row.id;
+        user.name = std::move(row.name);
+        user.role = static_cast<UserRole>(row.role);
+        user.restriction = std::move(row.restriction);
+    }
+}
+
+int SystemStore::ListUsers(Int64 afterId, Int32 maxCount, bool withRestriction, UserInfoVector &users)
+{
+    users.clear();
+    // SQLite reads a negative limit as no limit at all.
+    if ( maxCount <= 0 )
+    {
+        _pImpl->errMsg = "The page size must be positive.";
+        return NOK;
+    }
+
+    try
+    {
+        std::vector<UserRow> rows;
+        _pImpl->userTable->SelectPage(afterId, maxCount, withRestriction, rows);
+        users.resize(rows.size());
+        for ( size_t i = 0; i < rows.size(); ++ i )
+            ToUserInfo(rows[i], users[i]);
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::ForEachUser(bool withRestriction, const UserListCallback &callback)
+{
+    try
+    {
+        // The page is read and its statement reset before the callbacks
+        // run, so they may use the store, even the user table.
+        std::vector<UserRow> rows;
+        rows.reserve(USER_PAGE_SIZE);
+        UserInfo user;
+        Int64 afterId = 0;
+        for ( ;; )
+        {
+            rows.clear();
+            if ( _pImpl->userTable->SelectPage(afterId, USER_PAGE_SIZE, withRestriction, rows) == 0 )
+                return OK;
+            afterId = rows.back().id;
+            for ( auto &row : rows )
+            {
+                ToUserInfo(row, user);
+                if ( ! callback(user) )
+                    return OK;
+            }
+        }
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+Int32 SystemStore::GetRestrictionKey(const String &key)
+{
+    std::lock_guard<std::mutex> lock(_pImpl->restrictionMutex);
+    return _pImpl->restrictionKeys.Intern(key);
+}
+
+int SystemStore::IsAllowed(Int64 Id, Int32 keyHandle, bool &allowed)
+{
+    allowed = false;
+    try
+    {
+        Int64 generation = 0;
+        {
+            std::lock_guard<std::mutex> lock(_pImpl->restrictionMutex);
+            auto it = _pImpl->restrictions.find(Id);
+            if ( it != _pImpl->restrictions.end() )
+            {
+                allowed = it->second.IsAllowed(keyHandle);
+                return OK;
+            }
+            generation = _pImpl->restrictionsGeneration;
+        }
+
+        // Read and parsed without the lock, so other checks do not wait
+        // for the database.
+        UserRow row;
+        if ( ! _pImpl->userTable->SelectUserRow(Id, row) )
+            throw SQLite::Exception("User " + std::to_string(Id) + " does not exist.");
+        RestrictionEntries entries;
+        RestrictionSet::Parse(row.restriction, entries);
+
+        std::lock_guard<std::mutex> lock(_pImpl->restrictionMutex);
+        RestrictionSet set = RestrictionSet::Compile(entries, _pImpl->restrictionKeys);
+        allowed = set.IsAllowed(keyHandle);
+        // If a restriction was updated since the row was read, the row may
+        // be stale, so the set is not kept.
+        if ( generation == _pImpl->restrictionsGeneration )
+            _pImpl->restrictions.emplace(Id, std::move(set));
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::UpdateUserRestriction(Int64 Id, const String &restriction)
+{
+    try
+    {
+        // The profile swap is several statements.
+        Savepoint savepoint(*_pImpl->db);
+        if ( ! _pImpl->userTable->UpdateRestriction(Id, restriction) )
+            throw SQLite::Exception("User " + std::to_string(Id) + " does not exist.");
+        savepoint.Commit();
+        std::lock_guard<std::mutex> lock(_pImpl->restrictionMutex);
+        _pImpl->restrictions.erase(Id);
+        ++ _pImpl->restrictionsGeneration;
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+// Only the key schedule is shared, keyed in _Init. The password goes to the
+// block cipher and the cipher text is cut at its first zero byte as before.
+String SystemStore::_Encrypt(const String &strTarget) const
 {
-    CRijndael oRijndael;
-    oRijndael.MakeKey(ENCRYPT_KEY, "\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", 16, 16);
-    char szDataOut[1000];
-    memset(szDataOut, 0, sizeof(szDataOut));
-    oRijndael.EncryptBlock(strTarget.c_str(), szDataOut);
+    char szDataOut[CIPHER_BLOCK_SIZE + 1] = { 0 };
+    _pImpl->cipher.EncryptBlock(strTarget.c_str(), szDataOut);
     return String(szDataOut);
 }
 
 int SystemStore::AddParam(const String &name, Int32 value)
 {
-    String strValue = std::to_string(value);
     try
     {
-        _pImpl->paramTable->Insert(name, strValue);
+        _pImpl->InsertParam(name, value);
         return OK;
     }
     catch(SQLite::Exception &e)
     {
-        _pImpl->errMsg = e.getErrorStr();
+        _pImpl->SetErrMsg(e);
         return NOK;
     }
 }
 
 int SystemStore::AddParam(const String &name, double value)
 {
-    String strValue = std::to_string(value);
     try
     {
-        _pImpl->paramTable->Insert(name, strValue);
+        _pImpl->InsertParam(name, value);
         return OK;
     }
     catch(SQLite::Exception &e)
     {
-        _pImpl->errMsg = e.getErrorStr();
+        _pImpl->SetErrMsg(e);
         return NOK;
     }
 }
 
 int SystemStore::UpdateParam(const String &name, Int32 value)
 {
-    String strValue = std::to_string(value);
     try
     {
-        _pImpl->paramTable->UpdateValue(name, strValue);
+        _pImpl->UpdateParam(name, value);
         return OK;
     }
     catch(SQLite::Exception &e)
     {
-        _pImpl->errMsg = e.getErrorStr();
+        _pImpl->SetErrMsg(e);
         return NOK;
     }
 }
 
 int SystemStore::UpdateParam(const String &name, double value)
 {
-    String strValue = std::to_string(value);
     try
     {
-        _pImpl->paramTable->UpdateValue(name, strValue);
+        _pImpl->UpdateParam(name, value);
         return OK;
     }
     catch(SQLite::Exception &e)
     {
-        _pImpl->errMsg = e.getErrorStr();
+        _pImpl->SetErrMsg(e);
         return NOK;
     }
 }
 
-int SystemStore::GetParam(const String &name, Int32 &value)
+int SystemStore::AddParam(const String &name, const Binary &value)
 {
     try
     {
-        String strValue;
-        _pImpl->paramTable->SelectValue(name, strValue);
-        value = std::strtol ( strValue.c_str(), NULL, 10 );
+        _pImpl->InsertParam(name, value);
         return OK;
     }
     catch(SQLite::Exception &e)
     {
-        _pImpl->errMsg = e.getErrorStr();
+        _pImpl->SetErrMsg(e);
         return NOK;
     }
 }
 
-int SystemStore::GetParam(const String &name, double &value)
+int SystemStore::UpdateParam(const String &name, const Binary &value)
 {
     try
     {
-        String strValue;
-        _pImpl->paramTable->SelectValue(name, strValue);
-        value = std::strtof ( strValue.c_str(), NULL );
+        if ( ! _pImpl->UpdateParam(name, value) )
+        {
+            _pImpl->errMsg = "Param " + name + " does not exist.";
+            return NOK;
+        }
         return OK;
     }
     catch(SQLite::Exception &e)
     {
-        _pImpl->errMsg = e.getErrorStr();
+        _pImpl->SetErrMsg(e);
         return NOK;
     }
 }
 
+int SystemStore::SetParam(const String &name, Int32 value, bool &created)
+{
+    try
+    {
+        created = _pImpl->UpsertParam(name, value);
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::SetParam(const String &name, double value, bool &created)
+{
+    try
+    {
+        created = _pImpl->UpsertParam(name, value);
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::SetParam(const String &name, const Binary &value, bool &created)
+{
+    try
+    {
+        created = _pImpl->UpsertParam(name, value);
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::GetParam(const String &name, Int32 &value)
+{
+    try
+    {
+        ParamValue paramValue;
+        _pImpl->SelectParam(name, paramValue);
+        if ( paramValue.type == Enum::ParamType::BLOB )
+        {
+            _pImpl->errMsg = "Param " + name + " is binary.";
+            return NOK;
+        }
+        value = paramValue.AsInt32();
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::GetParam(const String &name, double &value)
+{
+    try
+    {
+        ParamValue paramValue;
+        _pImpl->SelectParam(name, paramValue);
+        if ( paramValue.type == Enum::ParamType::BLOB )
+        {
+            _pImpl->errMsg = "Param " + name + " is binary.";
+            return NOK;
+        }
+        value = paramValue.AsDouble();
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::GetParam(const String &name, Binary &value)
+{
+    try
+    {
+        _pImpl->paramTable->SelectBlob(name, [&value](const void *data, size_t size)
+        {
+            const unsigned char *bytes = static_cast<const unsigned char *>(data);
+            value.assign(bytes, bytes + size);
+        });
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::GetParam(const String &name, void *buffer, size_t capacity, size_t &size)
+{
+    try
+    {
+        _pImpl->paramTable->SelectBlob(name, [&](const void *data, size_t blobSize)
+        {
+            size = blobSize;
+            if ( blobSize <= capacity && blobSize > 0 )
+                memcpy(buffer, data, blobSize);
+        });
+        if ( size > capacity )
+        {
+            _pImpl->errMsg = "Param " + name + " does not fit in the buffer.";
+            return NOK;
+        }
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::ViewParam(const String &name, const BlobViewCallback &callback)
+{
+    try
+    {
+        _pImpl->paramTable->SelectBlob(name, callback);
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::GetParams(const StringVector &names, Int32Vector &values)
+{
+    try
+    {
+        _pImpl->SelectParams(names, values);
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::GetParams(const StringVector &names, DoubleVector &values)
+{
+    try
+    {
+        _pImpl->SelectParams(names, values);
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::SetParams(const Int32ParamVector &params)
+{
+    try
+    {
+        _pImpl->UpsertParams(params);
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::SetParams(const DoubleParamVector &params)
+{
+    try
+    {
+        _pImpl->UpsertParams(params);
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::GetParamsUnder(const String &prefix, Int32ParamVector &params)
+{
+    try
+    {
+        _pImpl->SelectParamsUnder(prefix, params);
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::GetParamsUnder(const String &prefix, DoubleParamVector &params)
+{
+    try
+    {
+        _pImpl->SelectParamsUnder(prefix, params);
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::ForEachParamUnder(const String &prefix, const ParamScanCallback &callback)
+{
+    try
+    {
+        String paramName;
+        _pImpl->paramTable->SelectUnder(prefix, [&](char const *name, size_t length, const ParamValue &paramValue)
+        {
+            if ( paramValue.type == Enum::ParamType::BLOB )
+                return true;
+            paramName.assign(name, length);
+            return callback(paramName, paramValue.AsDouble());
+        });
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::GetParamHistory(const String &name, Int64 fromTime, Int64 toTime, ParamChangeVector &changes)
+{
+    try
+    {
+        std::vector<ParamHistoryRow> rows;
+        _pImpl->paramHistoryTable->Select(name, fromTime, toTime, rows);
+        changes.clear();
+        changes.reserve(rows.size());
+        for ( auto const &row : rows )
+        {
+            ParamChange change;
+            change.time        = row.time;
+            change.name        = row.name;
+            change.userName    = row.userName;
+            change.hasOldValue = row.hasOldValue;
+            change.oldValue    = row.oldValue;
+            change.hasNewValue = row.hasNewValue;
+            change.newValue    = row.newValue;
+            changes.push_back(change);
+        }
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::SaveCalibration(const String &name, const FloatVector &values, Int64 &version)
+{
+    try
+    {
+        version = _pImpl->InsertCalibration(name, values);
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::SaveCalibration(const String &name, const DoubleVector &values, Int64 &version)
+{
+    try
+    {
+        version = _pImpl->InsertCalibration(name, values);
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::LoadCalibration(const String &name, FloatVector &values, Int64 &version)
+{
+    try
+    {
+        version = 0;
+        _pImpl->SelectCalibration(name, version, values);
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::LoadCalibration(const String &name, DoubleVector &values, Int64 &version)
+{
+    try
+    {
+        version = 0;
+        _pImpl->SelectCalibration(name, version, values);
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::LoadCalibration(const String &name, Int64 version, FloatVector &values)
+{
+    try
+    {
+        _pImpl->SelectCalibration(name, version, values);
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+int SystemStore::LoadCalibration(const String &name, Int64 version, DoubleVector &values)
+{
+    try
+    {
+        _pImpl->SelectCalibration(name, version, values);
+        return OK;
+    }
+    catch(SQLite::Exception &e)
+    {
+        _pImpl->SetErrMsg(e);
+        return NOK;
+    }
+}
+
+void SystemStore::GetParamCacheStats(Int64 &hitCount, Int64 &missCount) const
+{
+    hitCount  = _pImpl->paramCacheHits;
+    missCount = _pImpl->paramCacheMisses;
+}
+
+void SystemStore::GetStatementCacheStats(Int64 &hitCount, Int64 &missCount, Int64 &evictionCount, Int64 &compileMicroseconds) const
+{
+    StatementCache::Counters const counters = StatementCache::For(_pImpl->db)->GetCounters();
+    hitCount            = counters.hits;
+    missCount           = counters.misses;
+    evictionCount       = counters.evictions;
+    compileMicroseconds = counters.compileMicroseconds;
+}
+
+Int64 SystemStore::GetParamsVersion() const
+{
+    return _pImpl->paramsVersion;
+}
+
+Int64 SystemStore::GetParamVersion(const String &name) const
+{
+    std::lock_guard<std::mutex> lock(_pImpl->versionMutex);
+    return _pImpl->LatestParamVersion(StringVector(1, name));
+}
+
+Int64 SystemStore::SubscribeParamChange(const StringVector &names, const ParamChangeCallback &callback)
+{
+    std::lock_guard<std::mutex> lock(_pImpl->versionMutex);
+    Impl::Subscription &subscription = _pImpl->subscriptions[++ _pImpl->lastSubscriptionId];
+    subscription.names.insert(names.begin(), names.end());
+    subscription.callback = callback;
+    return _pImpl->lastSubscriptionId;
+}
+
+void SystemStore::UnsubscribeParamChange(Int64 subscriptionId)
+{
+    std::lock_guard<std::mutex> lock(_pImpl->versionMutex);
+    _pImpl->subscriptions.erase(subscriptionId);
+}
+
+int SystemStore::WaitParamChange(const StringVector &names, Int64 sinceVersion, Int32 timeoutMs, Int64 &version)
+{
+    std::unique_lock<std::mutex> lock(_pImpl->versionMutex);
+    bool changed = _pImpl->versionChanged.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&]()
+    {
+        version = _pImpl->LatestParamVersion(names);
+        return version > sinceVersion;
+    });
+    return changed ? OK : NOK;
+}
+
+SystemStore::Batch::Batch(SystemStore &systemStore) : _systemStore(systemStore), _changedMark(0), _open(false)
+{
+    Impl &impl = *_systemStore._pImpl;
+    try
+    {
+        Savepoint::Begin(*impl.db);
+        _changedMark = impl.batchChanged.size();
+        ++ impl.batchDepth;
+        _open = true;
+    }
+    catch(SQLite::Exception &e)
+    {
+        impl.SetErrMsg(e);
+    }
+}
+
+SystemStore::Batch::~Batch()
+{
+    if ( ! _open )
+        return;
+
+    Impl &impl = *_systemStore._pImpl;
+    Savepoint::Rollback(*impl.db);
+    impl.batchChanged.resize(_changedMark);
+    -- impl.batchDepth;
+    impl.ClearCaches();
+}
+
+int SystemStore::Batch::Commit()
+{
+    Impl &impl = *_systemStore._pImpl;
+    if ( ! _open )
+        return NOK;     // The message is that of the start.
+
+    try
+    {
+        Savepoint::Release(*impl.db);
+    }
+    catch(SQLite::Exception &e)
+    {
+        // Still open, so the caller may try again; the end undoes it.
+        impl.SetErrMsg(e);
+        return NOK;
+    }
+    _open = false;
+
+    if ( -- impl.batchDepth == 0 && ! impl.batchChanged.empty() )
+    {
+        StringVector names;
+        std::unordered_set<String> seen;
+        for ( auto const &name : impl.batchChanged )
+            if ( seen.insert(name).second )
+                names.push_back(name);
+        impl.batchChanged.clear();
+        impl.ParamsChanged(names);
+    }
+    return OK;
+}
+
+}
 }
-}
\ No newline at end of file
@@ -2,6 +2,9 @@
 
 #include <string>
 #include <memory>
+#include <vector>
+#include <utility>
+#include <functional>
 
 #pragma warning(push)
 #pragma warning(disable:4251)
@@ -33,26 +36,208 @@ enum class UserRole
 using String =      std::string;
 using Int64 =       __int64;
 using Int32 =       __int32;
+using Binary =              std::vector<unsigned char>;
+using StringVector =        std::vector<String>;
+using Int32Vector =         std::vector<Int32>;
+using FloatVector =         std::vector<float>;
+using DoubleVector =        std::vector<double>;
+using Int32ParamVector =    std::vector<std::pair<String, Int32>>;
+using DoubleParamVector =   std::vector<std::pair<String, double>>;
+using BlobViewCallback =    std::function<void(const void *data, size_t size)>;
+// A logged param change. Times are milliseconds since 1970-01-01 UTC. A
+// value is missing for a param that was created, and for binary values,
+// which are not kept.
+struct ParamChange
+{
+    Int64   time;
+    String  name;
+    String  userName;       // Empty if no user was logged in.
+    bool    hasOldValue;
+    double  oldValue;
+    bool    hasNewValue;
+    double  newValue;
+};
+using ParamChangeVector =   std::vector<ParamChange>;
+struct UserImport
+{
+    String      name;
+    String      password;
+    UserRole    role;
+    String      restriction;
+};
+using UserImportVector =    std::vector<UserImport>;
+// A listed user. The restriction is only filled when it is asked for.
+struct UserInfo
+{
+    Int64       Id;
+    String      name;
+    UserRole    role;
+    String      restriction;
+};
+using UserInfoVector =      std::vector<UserInfo>;
+using UserListCallback =    std::function<bool(const UserInfo &user)>;
+using ParamScanCallback =   std::function<bool(const String &name, double value)>;
+using ParamChangeCallback = std::function<void(const String &name, Int64 version)>;
 
 class API_CALL SystemStore
 {
 public:
+    // Construction options, may be or-ed together.
+    enum Options
+    {
+        // Loads every param into the cache with one table scan when the
+        // store is opened, instead of one query per param on first read.
+        PRELOAD_PARAMS = 1 << 0,
+        // Other stores or processes write the params too. Each read then
+        // checks the data version of the database first (one pragma), and
+        // drops the cache when another connection has written since. By
+        // default the cache only follows the writes of this store, and a
+        // read that hits it touches no database.
+        SHARED_PARAMS = 1 << 1,
+    };
+
     SystemStore();
+    explicit SystemStore(Int32 options);
     ~SystemStore();
     static String GetDatabaseName();
     String GetErrMsg() const;
     int AddUser(const String & name, const String & password, UserRole role, const String &restriction);
+    // Adds the users in one transaction, after encrypting the passwords
+    // (on several threads for large lists). A user that is rejected, e.g.
+    // for a duplicate name, is skipped and its error message is put in
+    // errors at its index; the others are added. errors is empty for the
+    // users that were added, and NOK is returned if any was rejected. If
+    // the transaction itself fails, no user is added.
+    int ImportUsers(const UserImportVector &users, StringVector &errors);
     int UserLogin(const String &name, const String &password, Int64 &Id);
+    // Logs in and starts a session. ValidateSession checks the token in
+    // memory, without the database or the cipher, and returns the user Id.
+    // A session ends when it has not been validated for the session timeout
+    // (30 minutes by default), on EndSession, and when the user's password
+    // is updated. Sessions live in this store object only. Validating does
+    // not change the user recorded in the param history, that is the user
+    // of the last login.
+    int UserLogin(const String &name, const String &password, Int64 &Id, String &sessionToken);
+    int ValidateSession(const String &sessionToken, Int64 &Id);
+    int ValidateSession(const String &sessionToken, Int64 &Id, String &userName);
+    void EndSession(const String &sessionToken);
+    void SetSessionTimeout(Int32 timeoutMs);
     int UpdatePassword(const String &name, const String &password, const String &passwordNew);
     int GetUserRoleAndRestriction(Int64 Id, UserRole&role, String &restriction );
+    // One page of users, those with Ids above afterId in Id order, at most
+    // maxCount of them. The next page starts after the last Id of this
+    // one; the first after Id 0. An empty page is the end. NOK is returned
+    // if maxCount is not positive.
+    int ListUsers(Int64 afterId, Int32 maxCount, bool withRestriction, UserInfoVector &users);
+    // Visits every user in Id order, reading a page at a time, so a large
+    // table is never held in memory. The callback may use this store and
+    // returns false to stop.
+    int ForEachUser(bool withRestriction, const UserListCallback &callback);
+    // Permission checks against the users' restriction documents. A key
+    // handle stands for the key of a <restriction key="..." value="..."/>
+    // element and is valid for the life of this store. A user's document is
+    // compiled on the first check and kept until UpdateUserRestriction
+    // changes it through this store. Keys the document does not name, or
+    // whose value is not "true", are not allowed.
+    Int32 GetRestrictionKey(const String &key);
+    int IsAllowed(Int64 Id, Int32 keyHandle, bool &allowed);
+    int UpdateUserRestriction(Int64 Id, const String &restriction);
     int AddParam(const String &name, Int32 value);
     int AddParam(const String &name, double value);
     int UpdateParam(const String &name, Int32 value);
     int UpdateParam(const String &name, double value);
+    // Binary params, e.g. calibration matrices. They are never cached.
+    int AddParam(const String &name, const Binary &value);
+    // Returns NOK if the param does not exist.
+    int UpdateParam(const String &name, const Binary &value);
+    // Updates the param, or adds it if it does not exist yet.
+    int SetParam(const String &name, Int32 value, bool &created);
+    int SetParam(const String &name, double value, bool &created);
+    int SetParam(const String &name, const Binary &value, bool &created);
     int GetParam(const String &name, Int32 &value);
     int GetParam(const String &name, double &value);
+    // Reads a binary param into value, reusing its capacity.
+    int GetParam(const String &name, Binary &value);
+    // Reads a binary param into the caller's buffer. size is set to the
+    // size of the param, and NOK is returned if it exceeds capacity.
+    int GetParam(const String &name, void *buffer, size_t capacity, size_t &size);
+    // Hands the callback SQLite's own buffer of a binary param without a
+    // copy. The buffer is only valid during the call. The callback may
+    // read params of this store, also with ViewParam.
+    int ViewParam(const String &name, const BlobViewCallback &callback);
+    // Batched access. Each batch runs in one transaction, so SetParams either
+    // sets every param or none of them. Like SetParam, it adds missing params.
+    int GetParams(const StringVector &names, Int32Vector &values);
+    int GetParams(const StringVector &names, DoubleVector &values);
+    int SetParams(const Int32ParamVector &params);
+    int SetParams(const DoubleParamVector &params);
+    // The params whose names start with the prefix, e.g. "camera.0.", in
+    // name order. Binary params are skipped. ForEachParamUnder streams the
+    // params to the callback one at a time instead of collecting them; the
+    // callback returns false to stop.
+    int GetParamsUnder(const String &prefix, Int32ParamVector &params);
+    int GetParamsUnder(const String &prefix, DoubleParamVector &params);
+    int ForEachParamUnder(const String &prefix, const ParamScanCallback &callback);
+    // The logged changes of a param in [fromTime, toTime], oldest first.
+    // The log keeps the latest 10000 changes of all params.
+    int GetParamHistory(const String &name, Int64 fromTime, Int64 toTime, ParamChangeVector &changes);
+    // Calibration results, e.g. lens distortion or height maps. Each save
+    // stores a new version, 1 for the first save of the name, and keeps the
+    // old ones. The arrays are stored compressed; values, including NaN and
+    // infinity, come back bit for bit. A version must be loaded with the
+    // element type it was saved with.
+    int SaveCalibration(const String &name, const FloatVector &values, Int64 &version);
+    int SaveCalibration(const String &name, const DoubleVector &values, Int64 &version);
+    // Loads the latest version and sets version to it.
+    int LoadCalibration(const String &name, FloatVector &values, Int64 &version);
+    int LoadCalibration(const String &name, DoubleVector &values, Int64 &version);
+    // Loads the given version.
+    int LoadCalibration(const String &name, Int64 version, FloatVector &values);
+    int LoadCalibration(const String &name, Int64 version, DoubleVector &values);
+    void GetParamCacheStats(Int64 &hitCount, Int64 &missCount) const;
+    // Counters of the prepared statement cache of this store's connection.
+    void GetStatementCacheStats(Int64 &hitCount, Int64 &missCount, Int64 &evictionCount, Int64 &compileMicroseconds) const;
+    // Change notification for params written through this store. Every
+    // write bumps the global version, and the version of a param is the
+    // global version of its last write (0 if never written). Reading the
+    // versions is safe from any thread and does not touch the database.
+    Int64 GetParamsVersion() const;
+    Int64 GetParamVersion(const String &name) const;
+    // The callback runs on the writing thread after the write committed.
+    // Empty names subscribes to every param. Returns the subscription Id.
+    Int64 SubscribeParamChange(const StringVector &names, const ParamChangeCallback &callback);
+    void UnsubscribeParamChange(Int64 subscriptionId);
+    // Waits until one of the params has a version above sinceVersion and
+    // returns OK with that version, or returns NOK when the timeout elapses.
+    int WaitParamChange(const StringVector &names, Int64 sinceVersion, Int32 timeoutMs, Int64 &version);
+
+    // Groups the writes made through the store while it lives into one
+    // transaction, so they share one journal sync. Batches nest, an inner
+    // batch is a savepoint of the outer one, and so do the store's own
+    // transactions, e.g. that of SetParams. Commit keeps the writes of the
+    // batch; a batch that ends without it undoes them, and the caches of
+    // the store are cleared. Sessions ended by an undone write stay ended.
+    // Param changes are notified when the outermost batch commits, with one
+    // version for all of them. Batches end in the reverse order they began.
+    class API_CALL Batch
+    {
+    public:
+        explicit Batch(SystemStore &systemStore);
+        ~Batch();
+        // Returns NOK if the batch could not be started, then its writes
+        // were made one by one, or could not be committed, e.g. when the
+        // database is busy. Commit may be tried again, or the end of the
+        // batch undoes its writes.
+        int Commit();
+    private:
+        Batch(const Batch &) = delete;
+        Batch &operator=(const Batch &) = delete;
+        SystemStore &_systemStore;
+        size_t       _changedMark;
+        bool         _open;
+    };
 private:
-    String _Encrypt(const String &input);
+    String _Encrypt(const String &input) const;
     Int32 _Init();
     struct Impl;
     std::unique_ptr<Impl> _pImpl;
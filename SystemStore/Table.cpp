@@ -9,6 +9,12 @@
  *   Four characters. No tabs!
  *
  * Modifications
+ *   2026-10-17 (XSG) Added a multi-row BuildInsertCommand for InsertBatch.
+ *   2026-10-17 (XSG) Prepared the built statements through the connection's cache.
+ *   2026-10-17 (XSG) Stepped and reset the query of GetExistsFor.
+ *   2026-10-17 (XSG) Added ResetAfterError.
+ *   2026-10-17 (XSG) Added BindNoCopy, reused the capacity in Exec.
+ *   2026-10-17 (XSG) Created variant fields without a declared type.
  *   2015-06-14 (MM) Added GetMaxFor methods.
  *   2012-05-29 (MM) Added a BuildUpdateCommand2 method.
  *   2012-05-14 (MM) Added more shorthand "For" methods (id with string).
@@ -33,6 +39,7 @@
 
 #include "Common/BaseDefs.h"
 #include "Table.h"
+#include "StatementCache.h"
 
 namespace AOI
 {
@@ -43,27 +50,33 @@ namespace SystemStore
     {
         if (!this->_db)
             throw SQLite::Exception(SL("Null connection argument to SQLiteImpl1::Table::Table."));
+        this->_statements = StatementCache::For(this->_db);
+    }
+
+    StatementPtr Table::Prepare(String const &sql) const
+    {
+        return this->_statements->Acquire(sql);
     }
 
     StatementPtr Table::BuildDeleteCommand(int keyFieldIndex) const
     {
         String const fmt = SL("delete from %s where %s = ?;");
         String const sql = (boost::format(fmt) % GetTableName() % GetFieldName(keyFieldIndex)).str();
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildDeleteCommand2(int keyFieldIndex1, int keyFieldIndex2) const
     {
         String const fmt = SL("delete from %s where %s = ? and %s = ?;");
         String const sql = (boost::format(fmt) % GetTableName() % GetFieldName(keyFieldIndex1) % GetFieldName(keyFieldIndex2)).str();
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildDeleteCommand3(int keyFieldIndex1, int keyFieldIndex2, int keyFieldIndex3) const
     {
         String const fmt = SL("delete from %s where %s = ? and %s = ? and %s = ?;");
         String const sql = (boost::format(fmt) % GetTableName() % GetFieldName(keyFieldIndex1) % GetFieldName(keyFieldIndex2) % GetFieldName(keyFieldIndex3)).str();
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildDeleteCommand(int const *fieldIndexBegin, int const *fieldIndexEnd) const
@@ -80,7 +93,7 @@ namespace SystemStore
         }
         sql += SL(";");
 
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildInsertCommand(int const *fieldIndexBegin, int const *fieldIndexEnd) const
@@ -97,15 +110,36 @@ namespace SystemStore
         }
 
         String sql = sql1 + sql2 + SL(");");
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }    
 
+    StatementPtr Table::BuildInsertCommand(int const *fieldIndexBegin, int const *fieldIndexEnd, int rowCount) const
+    {
+        assert(fieldIndexBegin != fieldIndexEnd && "Invalid field index iterators in Table::BuildInsertCommand.");
+        assert(rowCount > 0 && "Invalid row count in Table::BuildInsertCommand.");
+
+        String sql = SL("insert into ") + GetTableName() + SL(" (");
+        String row = SL("(");
+        for (int const *i = fieldIndexBegin, *n = fieldIndexEnd; i != n; ++i)
+        {
+            sql += ((i == fieldIndexBegin) ? SL("")  : SL(", ")) + GetFieldName(*i);
+            row += ((i == fieldIndexBegin) ? SL("?") : SL(", ?"));
+        }
+        row += SL(")");
+
+        sql += SL(") values ");
+        sql.reserve(sql.size() + rowCount * (row.size() + 2));
+        for (int r = 0; r < rowCount; ++r)
+            sql += ((r == 0) ? SL("") : SL(", ")) + row;
+        return Prepare(sql + SL(";"));
+    }
+
     StatementPtr Table::BuildSelectCommand(int fieldIndex, int keyFieldIndex) const
     {
         // Used when one single-column row will be selected.
         String const fmt = SL("select %s from %s where %s = ?;");
         String const sql = (boost::format(fmt) % GetFieldName(fieldIndex) % GetTableName() % GetFieldName(keyFieldIndex)).str();
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildSelectCommand(int fieldIndex, int keyFieldIndex1, int keyFieldIndex2) const
@@ -113,7 +147,7 @@ namespace SystemStore
         // Used when one single-column row will be selected.
         String const fmt = SL("select %s from %s where %s = ? and %s = ?;");
         String const sql = (boost::format(fmt) % GetFieldName(fieldIndex) % GetTableName() % GetFieldName(keyFieldIndex1) % GetFieldName(keyFieldIndex2) ).str();
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildSelectQuery(int fieldIndex) const
@@ -121,7 +155,7 @@ namespace SystemStore
          // Used when one single-column row will be selected.
         String const fmt = SL("select %s from %s;");
         String const sql = (boost::format(fmt) % GetFieldName(fieldIndex) % GetTableName()).str();
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildSelectQuery(int fieldIndex, int keyFieldIndex, int sortFieldIndex, bool distinct) const
@@ -134,7 +168,7 @@ namespace SystemStore
                    + SL(" where ") + GetFieldName(keyFieldIndex) + SL(" = ?");
         if (order) sql += SL(" order by ") + GetFieldName(sortFieldIndex);
         sql += ";";
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildSelectNotNullQuery(int fieldIndex, int keyFieldIndex, int sortFieldIndex, bool distinct) const
@@ -148,7 +182,7 @@ namespace SystemStore
                    + SL(" and ")   + GetFieldName(fieldIndex)    + SL(" is not null");
         if (order) sql += SL(" order by ") + GetFieldName(sortFieldIndex);
         sql += ";";
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildSelectQuery2(int fieldIndex, int keyFieldIndex1, int keyFieldIndex2, int sortFieldIndex, bool distinct) const
@@ -162,7 +196,7 @@ namespace SystemStore
                    + SL(" and ")   + GetFieldName(keyFieldIndex2) + SL(" = ?");
         if (order) sql += SL(" order by ") + GetFieldName(sortFieldIndex);
         sql += ";";
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildSelectQuery3(int fieldIndex, int keyFieldIndex1, int keyFieldIndex2, int keyFieldIndex3, int sortFieldIndex, bool distinct) const
@@ -177,7 +211,7 @@ namespace SystemStore
                    + SL(" and ")   + GetFieldName(keyFieldIndex3) + SL(" = ?");
         if (order) sql += SL(" order by ") + GetFieldName(sortFieldIndex);
         sql += ";";
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildSelectQuery(int const *fieldIndexBegin, int const *fieldIndexEnd, int keyFieldIndex, int sortFieldIndex, bool distinct) const
@@ -193,7 +227,7 @@ namespace SystemStore
         sql += SL(" from ") + GetTableName() + SL(" where ") + GetFieldName(keyFieldIndex) + SL(" = ?");
         if (order) sql += SL(" order by ") + GetFieldName(sortFieldIndex);
         sql += ";";
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildSelectQuery(int const *fieldIndexBegin, int const *fieldIndexEnd, int const *keyFieldIndexBegin, int const *keyFieldIndexEnd, int sortFieldIndex, bool distinct) const
@@ -213,91 +247,91 @@ namespace SystemStore
 
         if (order) sql += SL(" order by ") + GetFieldName(sortFieldIndex);
         sql += ";";
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildSelectCountCommand() const
     {
         String const fmt = SL("select count(*) from %s;");
         String const sql = (boost::format(fmt) % GetTableName()).str();
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildSelectCountCommand(int keyFieldIndex) const
     {
         String const fmt = SL("select count(*) from %s where %s = ?;");
         String const sql = (boost::format(fmt) % GetTableName() % GetFieldName(keyFieldIndex)).str();
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildSelectCountCommand2(int keyFieldIndex1, int keyFieldIndex2) const
     {
         String const fmt = SL("select count(*) from %s where %s = ? and %s = ?;");
         String const sql = (boost::format(fmt) % GetTableName() % GetFieldName(keyFieldIndex1) % GetFieldName(keyFieldIndex2)).str();
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildSelectCountCommand3(int keyFieldIndex1, int keyFieldIndex2, int keyFieldIndex3) const
     {
         String const fmt = SL("select count(*) from %s where %s = ? and %s = ? and %s = ?;");
         String const sql = (boost::format(fmt) % GetTableName() % GetFieldName(keyFieldIndex1) % GetFieldName(keyFieldIndex2) % GetFieldName(keyFieldIndex3)).str();
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildSelectExistsCommand(int keyFieldIndex) const
     {
         String const fmt = SL("select exists(select * from %s where %s = ?);");
         String const sql = (boost::format(fmt) % GetTableName() % GetFieldName(keyFieldIndex)).str();
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildSelectExistsCommand2(int keyFieldIndex1, int keyFieldIndex2) const
     {
         String const fmt = SL("select exists(select * from %s where %s = ? and %s = ?);");
         String const sql = (boost::format(fmt) % GetTableName() % GetFieldName(keyFieldIndex1) % GetFieldName(keyFieldIndex2)).str();
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildSelectExistsCommand3(int keyFieldIndex1, int keyFieldIndex2, int keyFieldIndex3) const
     {
         String const fmt = SL("select exists(select * from %s where %s = ? and %s = ? and %s = ?);");
         String const sql = (boost::format(fmt) % GetTableName() % GetFieldName(keyFieldIndex1) % GetFieldName(keyFieldIndex2) % GetFieldName(keyFieldIndex3)).str();
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildSelectMaxCommand(int fieldIndex) const
     {
         String const fmt = SL("select max(%s) from %s;");
         String const sql = (boost::format(fmt) % GetFieldName(fieldIndex) % GetTableName()).str();
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildSelectMaxCommand(int keyFieldIndex, int fieldIndex) const
     {
         String const fmt = SL("select max(%s) from %s where %s = ?;");
         String const sql = (boost::format(fmt) % GetFieldName(fieldIndex) % GetTableName() % GetFieldName(keyFieldIndex)).str();
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildSelectMaxCommand(int keyFieldIndex1, int keyFieldIndex2, int fieldIndex) const
     {
         String const fmt = SL("select max(%s) from %s where %s = ? and %s = ?;");
         String const sql = (boost::format(fmt) % GetFieldName(fieldIndex) % GetTableName() % GetFieldName(keyFieldIndex1) % GetFieldName(keyFieldIndex2)).str();
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildSelectMaxCommand(int keyFieldIndex1, int keyFieldIndex2, int keyFieldIndex3, int fieldIndex) const
     {
         String const fmt = SL("select max(%s) from %s where %s = ? and %s = ? and %s = ?;");
         String const sql = (boost::format(fmt) % GetFieldName(fieldIndex) % GetTableName() % GetFieldName(keyFieldIndex1) % GetFieldName(keyFieldIndex2) % GetFieldName(keyFieldIndex3)).str();
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildUpdateCommand(int fieldIndex, int keyFieldIndex) const
     {
         String const fmt = SL("update %s set %s = ? where %s = ?;");
         String const sql = (boost::format(fmt) % GetTableName() % GetFieldName(fieldIndex) % GetFieldName(keyFieldIndex)).str();
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildUpdateCommand(int const *fieldIndexBegin, int const *fieldIndexEnd, int keyFieldIndex) const
@@ -310,14 +344,14 @@ namespace SystemStore
             sql += ((i == fieldIndexBegin) ? SL(" set ") : SL(", ")) + GetFieldName(*i) + SL(" = ?");
 
         sql += SL(" where ") + GetFieldName(keyFieldIndex) + SL(" = ?;");
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     StatementPtr Table::BuildUpdateCommand2(int fieldIndex, int keyFieldIndex1, int keyFieldIndex2) const
     {
         String const fmt = SL("update %s set %s = ? where %s = ? and %s = ?;");
         String const sql = (boost::format(fmt) % GetTableName() % GetFieldName(fieldIndex) % GetFieldName(keyFieldIndex1) % GetFieldName(keyFieldIndex2)).str();
-        return std::make_shared<SQLite::Statement>( *_db.get(), sql );
+        return Prepare(sql);
     }
 
     void Table::GetMaxFor(StatementPtr &command, int selectFieldIndex, Int32 &value) const
@@ -498,8 +532,9 @@ namespace SystemStore
             command = BuildSelectExistsCommand(keyFieldIndex);
 
         bind(command, 1, keyValue, Table::ID_SAFE);
-        command->exec();
-        return command->getColumn(0).getInt() != 0;
+        Int32 exists;
+        Exec(command, exists);
+        return exists != 0;
     }
 
     void Table::GetMaxFor(StatementPtr &command, int keyFieldIndex, Int64 keyValue, int selectFieldIndex, Int32 &value) const
@@ -1102,9 +1137,24 @@ namespace SystemStore
         query->bind(index, value);
     }
 
+    namespace
+    {
+        // SQLite binds a null pointer as null, not as an empty blob.
+        void const *BlobData(Binary const &value)
+        {
+            static Byte const empty = 0;
+            return value.empty() ? &empty : value.data();
+        }
+    }
+
     void Table::Bind(StatementPtr const &query, Int32 index, Binary const &value) const
     {
-        query->bind(index, &value[0], value.size() );
+        query->bind(index, BlobData(value), static_cast<int>(value.size()) );
+    }
+
+    void Table::BindNoCopy(StatementPtr const &query, Int32 index, Binary const &value) const
+    {
+        query->bindNoCopy(index, BlobData(value), static_cast<int>(value.size()) );
     }
 
     void Table::Bind(StatementPtr const &command, Int32 index, Int64 value, int fieldIndex) const
@@ -1128,10 +1178,11 @@ namespace SystemStore
         command->bind(index, value);
     }
 
-    void Table::Exec(StatementPtr const &command) const
+    int Table::Exec(StatementPtr const &command) const
     {
-        command->exec();
+        int changes = command->exec();
         command->reset();   //Add by SG.Xiao, 10Nov2016
+        return changes;
     }
 
     void Table::Exec(StatementPtr const &command, Int32 &value) const
@@ -1166,11 +1217,13 @@ namespace SystemStore
     {
         command->executeStep();
 
+        // Assigned rather than swapped in, so the capacity of the value is
+        // reused when the caller reads into the same vector again.
         typedef Binary::value_type const Target;
         const void *source = command->getColumn(0).getBlob();
         int n = command->getColumn(0).size();
         Target *t = reinterpret_cast<Target *>(source);
-        Binary(t, t + n).swap(value);
+        value.assign(t, t + n);
         command->reset();   //Add by SG.Xiao, 10Nov2016
     }
 
@@ -1179,6 +1232,17 @@ namespace SystemStore
         return _db->getLastInsertRowid();
     }
 
+    void Table::ResetAfterError(StatementPtr const &command) const
+    {
+        try
+        {
+            command->reset();
+        }
+        catch (SQLite::Exception &)
+        {
+        }
+    }
+
     int Table::GetConstraintCount() const
     {
         return 0;
@@ -1211,12 +1275,13 @@ namespace SystemStore
 
         for (int i = 0, n = GetFieldCount(); i != n; ++i)
         {
-            int    fieldBits = GetFieldBits(i);
-            String fieldSql  = GetFieldSql(i);
+            String fieldSql = GetFieldSql(i);
 
             sql += ((i == 0) ? SL("") : SL(", ")) + GetFieldName(i);
 
-            if (IsBinary(i))
+            if (IsVariant(i))
+                ; // No declared type, so SQLite keeps the storage class of each bound value.
+            else if (IsBinary(i))
                 sql += SL(" blob");
             else if (IsString(i))
                 sql += SL(" text");
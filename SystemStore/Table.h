@@ -11,6 +11,12 @@
  *   Four characters. No tabs!
  *
  * Modifications
+ *   2026-10-17 (XSG) Befriended the InsertBatch template.
+ *   2026-10-17 (XSG) Added a multi-row BuildInsertCommand for InsertBatch.
+ *   2026-10-17 (XSG) Prepared the built statements through the connection's cache.
+ *   2026-10-17 (XSG) Added ResetAfterError.
+ *   2026-10-17 (XSG) Added BindNoCopy for blobs.
+ *   2026-10-17 (XSG) Added the variant field bit.
  *   2015-06-14 (MM) Added GetMaxFor methods.
  *   2012-05-29 (MM) Added a BuildUpdateCommand2 method.
  *   2012-05-14 (MM) Added more shorthand "For" methods.
@@ -37,19 +43,30 @@ namespace AOI
 namespace SystemStore
 {
     class Table;
+    class StatementCache;
+    template <class TableT> class InsertBatch;
 
     using StatementPtr  = std::shared_ptr<SQLite::Statement>;
     using TablePtr      = std::shared_ptr<Table>;
     using TableConstPtr = std::shared_ptr<Table const>;
     using DatabasePtr   = std::shared_ptr<SQLite::Database>;
+    using StatementCachePtr = std::shared_ptr<StatementCache>;
     #define ToInt32(param)      (static_cast<Int32>(param))
 
     class Table: private Uncopyable
     {
         DatabasePtr mutable _db;
+        StatementCachePtr   _statements;
+
+        template <class TableT> friend class InsertBatch;
     protected:
         explicit Table(DatabasePtr const &db);
 
+        // Returns the connection's statement for the SQL, reset and with
+        // its bindings cleared, or a new one while that is held elsewhere.
+        // All the Build methods use it.
+        StatementPtr Prepare(String const &sql) const;
+
         static int  const UNSORTED = -1;
         static bool const DISTINCT = true;
 
@@ -80,6 +97,12 @@ namespace SystemStore
         // Bind(n,   <fieldValue>);   /* n = fieldIndexEnd - fieldIndexBegin; */
         StatementPtr BuildInsertCommand(int const *fieldIndexBegin, int const *fieldIndexEnd) const;        
 
+        // Sql: "insert into <table> (<f1>, ..., <fn>) values (<v1>, ..., <vn>), ..., (<v1>, ..., <vn>);".
+        // Bind(1,       <fieldValue of row 1>);
+        // Bind(...,     <fieldValue>);
+        // Bind(n*rows,  <fieldValue of row rows>);
+        StatementPtr BuildInsertCommand(int const *fieldIndexBegin, int const *fieldIndexEnd, int rowCount) const;
+
         // Sql: "select <f1> from <table> where <key> = ?;".
         // Bind(1, <keyFieldValue>);
         StatementPtr BuildSelectCommand(int fieldIndex, int keyFieldIndex) const;
@@ -269,6 +292,8 @@ namespace SystemStore
         void Bind(StatementPtr const &q, Int32 index, double        value) const;
         void Bind(StatementPtr const &q, Int32 index, String const &value) const;
         void Bind(StatementPtr const &q, Int32 index, Binary const &value) const;
+        // The value must outlive the next step of the statement.
+        void BindNoCopy(StatementPtr const &q, Int32 index, Binary const &value) const;
 
         // Special command binders are required for use with Int64 values.
         // Use the "field index" form for values being inserted or updated.
@@ -277,8 +302,9 @@ namespace SystemStore
         void Bind(StatementPtr const &c, Int32 index, Int64 value, int fieldIndex) const;
         void Bind(StatementPtr const &c, Int32 index, Int64 value, bool) const;
 
-        // Shorthand execs to match the binders.
-        void Exec(StatementPtr const &)                const;
+        // Shorthand execs to match the binders. The command form returns
+        // the number of rows changed.
+        int  Exec(StatementPtr const &)                const;
         void Exec(StatementPtr const &, Int32  &value) const;
         void Exec(StatementPtr const &, Int64  &value) const;
         void Exec(StatementPtr const &, double &value) const;
@@ -287,6 +313,11 @@ namespace SystemStore
 
         Int64 GetLastInsertedRowId() const;
 
+        // Resets a statement whose step failed, so it can be kept for
+        // reuse. sqlite3_reset repeats the error of the step, which the
+        // caller is already handling, so it is not thrown again.
+        void ResetAfterError(StatementPtr const &) const;
+
     public:
         virtual ~Table() {}
 
@@ -311,6 +342,7 @@ namespace SystemStore
         static int const BIT_NCSTR   = 1 << 5;
         static int const BIT_WCSTR   = 1 << 6;  /* reserved */
         static int const BIT_BLOB    = 1 << 7;
+        static int const BIT_VARIANT = 1 << 8;  /* no declared type; integer, real or blob per row */
         static int const BIT_PKEYASC = 1 << 12; /* primary key asc */
         static int const BIT_PKEYINC = 1 << 13; /* primary key asc autoincrement */
         static int const BIT_UNIQUE  = 1 << 14;
@@ -327,6 +359,7 @@ namespace SystemStore
         bool IsFloating(int fieldIndex) const { return 0 != (GetFieldBits(fieldIndex) & (BIT_FLT32   | BIT_FLT64)); }
         bool IsString  (int fieldIndex) const { return 0 != (GetFieldBits(fieldIndex) & (BIT_NCSTR   | BIT_WCSTR)); }
         bool IsBinary  (int fieldIndex) const { return 0 != (GetFieldBits(fieldIndex) &  BIT_BLOB); }
+        bool IsVariant (int fieldIndex) const { return 0 != (GetFieldBits(fieldIndex) &  BIT_VARIANT); }
         bool IsIntId   (int fieldIndex) const { return 0 != (GetFieldBits(fieldIndex) &  BIT_INTID); }
         bool IsPKey    (int fieldIndex) const { return 0 != (GetFieldBits(fieldIndex) & (BIT_PKEYASC | BIT_PKEYINC)); }
         bool IsPKeyAsc (int fieldIndex) const { return 0 != (GetFieldBits(fieldIndex) &  BIT_PKEYASC); }
@@ -1,45 +1,95 @@
 #include "Common/BaseDefs.h"
 #include "UserTable.h"
+#include "RestrictionProfileTableLayout.h"
+#include "InsertBatch.h"
+#include "Savepoint.h"
+#include <SQLite3/sqlite3.h>
+#include <unordered_map>
 
 namespace AOI
 {
 namespace SystemStore
 {
-    namespace
-    {
-        Table::FieldEntry const myFields[] =
-        {
-            { SL("id"),                  Table::BIT_INTID | Table::BIT_PKEYINC, SL("") },
-            { SL("name"),                Table::BIT_NCSTR | Table::BIT_UNIQUE,  SL("") },
-            { SL("password"),            Table::BIT_NCSTR,                      SL("") },
-            { SL("role"),                Table::BIT_INT32,                      SL("") },
-            { SL("restriction"),         Table::BIT_NCSTR,                      SL("") },            
-        };
+    // The layout as literals, shared by the field table and the SQL of the
+    // frequent statements, which the compiler puts together.
+    #define USER_TABLE                  "users"
+    #define USER_ID                     "id"
+    #define USER_NAME                   "name"
+    #define USER_PASSWORD               "password"
+    #define USER_ROLE                   "role"
+    #define USER_RESTRICTION_PROFILE    "restrictionProfile"
 
-        BOOST_STATIC_ASSERT(sizeof(myFields) / sizeof(myFields[0]) == UserTable::COUNT_);
-    }
+    // The users as u, each joined to its profile as p.
+    #define USER_WITH_PROFILE   " from " USER_TABLE " as u left join " RESTRICTION_PROFILE_TABLE " as p on p." RESTRICTION_PROFILE_ID " = u." USER_RESTRICTION_PROFILE
 
-    int UserTable::GetFieldBits(int index) const
+    /*static*/String UserTable::StaticGetTableName()
     {
-        assert(index >= 0 && index < GetFieldCount() && "Field index out of range in UserTable::GetFieldBits.");
-        return myFields[index].fieldBits;
+        return SL(USER_TABLE);
     }
 
-    String UserTable::GetFieldName(int index) const
+    /*static*/Table::FieldEntry const &UserTable::StaticGetField(int index)
     {
-        assert(index >= 0 && index < GetFieldCount() && "Field index out of range in UserTable::GetFieldName.");
-        return myFields[index].fieldName;
+        static FieldEntry const fields[] =
+        {
+            { SL(USER_ID),                  BIT_INTID | BIT_PKEYINC, SL("") },
+            { SL(USER_NAME),                BIT_NCSTR | BIT_UNIQUE,  SL("") },
+            { SL(USER_PASSWORD),            BIT_NCSTR,               SL("") },
+            { SL(USER_ROLE),                BIT_INT32,               SL("") },
+            { SL(USER_RESTRICTION_PROFILE), BIT_INT64,               SL("") },
+        };
+
+        BOOST_STATIC_ASSERT(sizeof(fields) / sizeof(fields[0]) == COUNT_);
+        return fields[index];
     }
 
-    String UserTable::GetFieldSql(int index) const
+    void UserTable::Index()
     {
-        assert(index >= 0 && index < GetFieldCount() && "Field index out of range in UserTable::GetFieldSql.");
-        return myFields[index].fieldSql;
+        String const fmt = SL("create index %1%_%2% on %1% (%2%);");
+        GetDatabase()->exec((boost::format(fmt) % GetTableName() % GetFieldName(RESTRICTION_PROFILE)).str());
     }
 
-    /*static*/String UserTable::StaticGetTableName()
+    bool UserTable::Migrate()
     {
-        return SL("users");
+        // The old layout kept the whole restriction document in each row.
+        bool legacy = false;
+        {
+            SQLite::Statement query(*GetDatabase().get(), SL("pragma table_info(") + GetTableName() + SL(");"));
+            while (query.executeStep())
+                if (query.getColumn(1).getString() == SL("restriction"))
+                    legacy = true;
+        }
+        if (!legacy)
+            return false;
+
+        String const tn  = GetTableName();
+        String const old = tn + SL("_legacy");
+
+        SQLite::Transaction transaction(*GetDatabase().get());
+        GetDatabase()->exec(SL("alter table ") + tn + SL(" rename to ") + old + SL(";"));
+        Create();
+
+        // The documents are interned one by one, as the hash is not
+        // available in SQL. The ids are kept.
+        int const fi [ ] = { ID, NAME, PASSWORD, ROLE, RESTRICTION_PROFILE };
+        StatementPtr insertWithId = BuildInsertCommand(fi, fi + sizeof(fi) / sizeof(fi [ 0 ]));
+        {
+            String const fmt = SL("select %1%, %2%, %3%, %4%, restriction from %5%;");
+            SQLite::Statement query(*GetDatabase().get(),
+                (boost::format(fmt) % GetFieldName(ID) % GetFieldName(NAME) % GetFieldName(PASSWORD) % GetFieldName(ROLE) % old).str());
+            while (query.executeStep())
+            {
+                int i = 0;
+                Bind(insertWithId, ++i, query.getColumn(0).getInt64(), ID);
+                Bind(insertWithId, ++i, query.getColumn(1).getString());
+                Bind(insertWithId, ++i, query.getColumn(2).getString());
+                Bind(insertWithId, ++i, query.getColumn(3).getInt());
+                Bind(insertWithId, ++i, this->profiles->Intern(query.getColumn(4).getString()), RESTRICTION_PROFILE);
+                Exec(insertWithId);
+            }
+        }
+        GetDatabase()->exec(SL("drop table ") + old + SL(";"));
+        transaction.commit();
+        return true;
     }
 
     Int64 UserTable::Insert
@@ -50,46 +100,174 @@ namespace SystemStore
         String const &restriction
     )
     {
+        // The profile may be interned for this user only, so it is undone
+        // with a rejected insert. Inside an import, only this user is.
+        Savepoint savepoint(*GetDatabase());
+        Int64 const profileId = this->profiles->Intern(restriction);
         try
         {
             if (!this->insert)
             {
-                int const fi [ ] = { NAME, PASSWORD, ROLE, RESTRICTION };
-                this->insert = BuildInsertCommand(fi, fi + sizeof(fi) / sizeof(fi [ 0 ]));
+                this->insert = Prepare(SL("insert into " USER_TABLE " (" USER_NAME ", " USER_PASSWORD ", " USER_ROLE ", " USER_RESTRICTION_PROFILE ") values (?, ?, ?, ?);"));
             }
 
             int i = 0;
             Bind(this->insert, ++i, name);
             Bind(this->insert, ++i, password);
             Bind(this->insert, ++i, role);
-            Bind(this->insert, ++i, restriction);
+            Bind(this->insert, ++i, profileId, RESTRICTION_PROFILE);
             Exec(this->insert);
 
-            return GetLastInsertedRowId();
+            Int64 const id = GetLastInsertedRowId();
+            savepoint.Commit();
+            return id;
         }
         catch (...)
         {
-            this->insert.reset();
+            // Kept, so that a rejected user (e.g. a duplicate name) does
+            // not cost the next insert a compile.
+            if (this->insert)
+                ResetAfterError(this->insert);
             throw;
         }
     }
 
-    void UserTable::UpdatePassword
+    size_t UserTable::Import
     (
-        Int64         id,
-        String const &password
+        size_t               count,
+        String const        *names,
+        String const        *passwords,
+        Int32 const         *roles,
+        String const        *restrictions,
+        RejectVisitor const &rejected
     )
     {
-        Update(id, this->updatePassword, PASSWORD, password);
+        int const fi [ ] = { NAME, PASSWORD, ROLE, RESTRICTION_PROFILE };
+        InsertBatch<UserTable> batch(*this, fi, fi + sizeof(fi) / sizeof(fi [ 0 ]));
+        size_t const batchRows = batch.GetBatchRows();
+
+        // The batches nest in the savepoint of the import, so a failed
+        // batch leaves a transaction open, and one that is no longer open
+        // means the error ended it, also without a caller's transaction.
+        Savepoint import(*GetDatabase());
+
+        // An import gives its users few documents, each is interned once.
+        std::unordered_map<String, Int64> interned;
+        Int64Vector profileIds(std::min(count, batchRows));
+        size_t inserted = 0;
+        for (size_t begin = 0; begin < count; begin += batchRows)
+        {
+            size_t const end = std::min(count, begin + batchRows);
+            try
+            {
+                // The profiles are interned in the savepoint of the batch,
+                // so a rejected batch leaves none behind.
+                Savepoint savepoint(*GetDatabase());
+                for (size_t i = begin; i < end; ++i)
+                {
+                    auto found = interned.find(restrictions[i]);
+                    if (found == interned.end())
+                        found = interned.insert(std::make_pair(restrictions[i], this->profiles->Intern(restrictions[i]))).first;
+                    profileIds[i - begin] = found->second;
+                }
+
+                // A full batch is inserted by its last row, the last one
+                // by Flush.
+                batch.AddColumns(end - begin, names + begin, passwords + begin, roles + begin, &profileIds[0]);
+                batch.Flush();
+                savepoint.Commit();
+                inserted += end - begin;
+                continue;
+            }
+            catch (SQLite::Exception const &)
+            {
+                // An error that rolled back the transaction (e.g. a full
+                // disk) ends the import.
+                if (sqlite3_get_autocommit(GetDatabase()->getHandle()) != 0)
+                    throw;
+            }
+
+            // The batch was rolled back, profiles included, and Insert
+            // undoes the profile it interned for a user it rejects, so the
+            // interned ids may be gone.
+            interned.clear();
+            for (size_t i = begin; i < end; ++i)
+            {
+                try
+                {
+                    Insert(names[i], passwords[i], roles[i], restrictions[i]);
+                    ++inserted;
+                }
+                catch (SQLite::Exception const &e)
+                {
+                    if (sqlite3_get_autocommit(GetDatabase()->getHandle()) != 0)
+                        throw;
+                    rejected(i, e);
+                }
+            }
+        }
+        import.Commit();
+        return inserted;
+    }
+
+    bool UserTable::UpdatePassword
+    (
+        String const &name,
+        String const &password,
+        String const &passwordNew
+    )
+    {
+        try
+        {
+            if (!this->updatePassword)
+            {
+                this->updatePassword = Prepare(SL("update " USER_TABLE " set " USER_PASSWORD " = ? where " USER_NAME " = ? and " USER_PASSWORD " = ?;"));
+            }
+
+            int i = 0;
+            Bind(this->updatePassword, ++i, passwordNew);
+            Bind(this->updatePassword, ++i, name);
+            Bind(this->updatePassword, ++i, password);
+            return Exec(this->updatePassword) != 0;
+        }
+        catch (...)
+        {
+            if (this->updatePassword)
+                ResetAfterError(this->updatePassword);
+            throw;
+        }
     }
 
-    void UserTable::UpdateRestriction
+    bool UserTable::UpdateRestriction
     (
         Int64         id,
         String const &restriction
     )
     {
-        Update(id, this->updateRestriction, RESTRICTION, restriction);
+        Int64 oldProfileId = 0;
+        int const fi [ ] = { RESTRICTION_PROFILE };
+        if (!SelectRow(id, this->selectProfile, fi, fi + 1, [&oldProfileId](SQLite::Statement &select)
+            {
+                oldProfileId = select.getColumn(0).getInt64();
+            }))
+            return false;
+
+        // The user is moved before the old profile is released, so an
+        // interrupted update leaves an unused profile at worst, never a
+        // user without one.
+        Int64 const profileId = this->profiles->Intern(restriction);
+        if (profileId == oldProfileId)
+            return true;
+
+        Update(id, this->updateRestriction, RESTRICTION_PROFILE, profileId);
+        ReleaseProfile(oldProfileId);
+        return true;
+    }
+
+    void UserTable::ReleaseProfile(Int64 profileId)
+    {
+        if (!GetExistsFor(this->selectProfileUsed, RESTRICTION_PROFILE, profileId))
+            this->profiles->Delete(profileId);
     }
 
     Int64 UserTable::SelectUser
@@ -102,7 +280,7 @@ namespace SystemStore
         {
             if (!this->selectUser)
             {
-                this->selectUser = BuildSelectCommand(ID, NAME, PASSWORD);
+                this->selectUser = Prepare(SL("select " USER_ID " from " USER_TABLE " where " USER_NAME " = ? and " USER_PASSWORD " = ?;"));
             }
 
             int i = 0;
@@ -121,14 +299,87 @@ namespace SystemStore
         }
     }
 
-    void UserTable::SelectRole(Int64 id, Int32 &value) const
+    bool UserTable::SelectUserRow(Int64 id, UserRow &row) const
     {
-        Select(id, this->selectRole, ROLE, value);
+        // The profile is joined in, so the row is still read in one query.
+        // Most users share a few profiles, whose pages stay in the cache.
+        try
+        {
+            if (!this->selectUserRow)
+            {
+                this->selectUserRow = Prepare(SL("select u." USER_NAME ", u." USER_ROLE ", p." RESTRICTION_PROFILE_DOCUMENT
+                    USER_WITH_PROFILE " where u." USER_ID " = ?;"));
+            }
+
+            Bind(this->selectUserRow, 1, id, ID_SAFE);
+            if (!this->selectUserRow->executeStep())
+            {
+                this->selectUserRow->reset();
+                return false;
+            }
+
+            // getBytes must follow getText, see sqlite3_column_bytes.
+            SQLite::Column name = this->selectUserRow->getColumn(0);
+            char const *text = name.getText();
+            row.name.assign(text, static_cast<size_t>(name.getBytes()));
+
+            row.id   = id;
+            row.role = this->selectUserRow->getColumn(1).getInt();
+
+            SQLite::Column restriction = this->selectUserRow->getColumn(2);
+            text = restriction.getText();
+            row.restriction.assign(text, static_cast<size_t>(restriction.getBytes()));
+
+            this->selectUserRow->reset();
+            return true;
+        }
+        catch (...)
+        {
+            if (this->selectUserRow)
+                ResetAfterError(this->selectUserRow);
+            throw;
+        }
     }
 
-    void UserTable::SelectRestriction(Int64 id, String &value) const
+    size_t UserTable::SelectPage(Int64 afterId, Int32 maxCount, bool withRestriction, std::vector<UserRow> &rows) const
     {
-        Select(id, this->selectRestriction, RESTRICTION, value);
+        // Keyset pagination: the id is the rowid, so each page is a range
+        // scan that starts at the previous page's last id, however deep
+        // the page is.
+        StatementPtr &select = withRestriction ? this->selectPageWithRestriction : this->selectPage;
+        try
+        {
+            if (!select)
+            {
+                select = Prepare(withRestriction
+                    ? SL("select u." USER_ID ", u." USER_NAME ", u." USER_ROLE ", p." RESTRICTION_PROFILE_DOCUMENT
+                         USER_WITH_PROFILE " where u." USER_ID " > ? order by u." USER_ID " limit ?;")
+                    : SL("select " USER_ID ", " USER_NAME ", " USER_ROLE " from " USER_TABLE " where " USER_ID " > ? order by " USER_ID " limit ?;"));
+            }
+
+            Bind(select, 1, afterId, ID_SAFE);
+            Bind(select, 2, maxCount);
+
+            size_t const first = rows.size();
+            while (select->executeStep())
+            {
+                rows.push_back(UserRow());
+                UserRow &row = rows.back();
+                row.id   = select->getColumn(0).getInt64();
+                row.name = select->getColumn(1).getString();
+                row.role = select->getColumn(2).getInt();
+                if (withRestriction)
+                    row.restriction = select->getColumn(3).getString();
+            }
+            select->reset();
+            return rows.size() - first;
+        }
+        catch (...)
+        {
+            if (select)
+                ResetAfterError(select);
+            throw;
+        }
     }
 
 }
@@ -12,12 +12,25 @@
  *   Four characters. No tabs!
  *
  * Modifications
+ *   2026-10-17 (XSG) Gave Import a savepoint of its own.
+ *   2026-10-17 (XSG) Moved the layout literals back to the implementation.
+ *   2026-10-17 (XSG) Indexed the restriction profile in Index, not in Create.
+ *   2026-10-17 (XSG) Added Import, which inserts users in batches.
+ *   2026-10-17 (XSG) Described the fields inline through StaticTable.
+ *   2026-10-17 (XSG) Wrote the SQL of the frequent statements as literals.
+ *   2026-10-17 (XSG) Checked the old password in the password update.
+ *   2026-10-17 (XSG) Kept the restriction in a shared profile.
+ *   2026-10-17 (XSG) Added a page select in id order.
+ *   2026-10-17 (XSG) Kept the insert statement after a failed insert.
+ *   2026-10-17 (XSG) Replaced the role and restriction selects by a row select.
  *   2016-11-09 (XSG) Created.
  *
  * Copyright (c) 2016-2016, Xiao Shengguang.  All rights reserved.
  ****************************************************************************/
 
 #include "IdBasedTable.h"
+#include "StaticTable.h"
+#include "RestrictionProfileTable.h"
 
 namespace AOI
 {
@@ -27,10 +40,19 @@ namespace SystemStore
 
     using UserTablePtr = std::shared_ptr<UserTable>;
 
-    class UserTable : public IdBasedTable
+    // The fields of a user other than the password.
+    struct UserRow
+    {
+        Int64  id;
+        String name;
+        Int32  role;
+        String restriction;
+    };
+
+    class UserTable: public StaticTable<UserTable, IdBasedTable>
     {
     public:
-        explicit UserTable(DatabasePtr const &database ) : IdBasedTable( database )   {}
+        UserTable(DatabasePtr const &database, RestrictionProfileTablePtr const &profileTable) : StaticTable(database), profiles( profileTable ) {}
         virtual ~UserTable() {};
         
         enum FieldIndex
@@ -39,7 +61,7 @@ namespace SystemStore
             NAME,
             PASSWORD,
             ROLE,
-            RESTRICTION,
+            RESTRICTION_PROFILE,
             COUNT_,
         };
 
@@ -47,10 +69,6 @@ namespace SystemStore
         * Table *
         ********/
         virtual String GetTableName()    const override { return StaticGetTableName(); }
-        virtual int    GetFieldCount()   const override { return COUNT_; }
-        virtual String GetFieldName(int) const override;
-        virtual int    GetFieldBits(int) const override;
-        virtual String GetFieldSql (int) const override;
 
         /***************
         * IdBasedTable *
@@ -61,7 +79,19 @@ namespace SystemStore
         *  UserTable *
         *************/
         static String StaticGetTableName();
+        // The layout, see StaticTable.
+        static FieldEntry const &StaticGetField(int index);
+
+        // Indexes the restriction profile when the table is created.
+        virtual void Index();
 
+        // Moves the restriction of each user of the old layout, which kept
+        // the document in the row, into a shared profile. Returns false if
+        // the table already has the current layout.
+        bool Migrate();
+
+        // The restriction is stored as a reference to the profile with the
+        // same document.
         Int64 Insert
         (
             String const &name,
@@ -70,13 +100,39 @@ namespace SystemStore
             String const &restriction
         );
 
-        void UpdatePassword
+        // Called with the index and the error of a user Import rejected.
+        using RejectVisitor = std::function<void(size_t index, SQLite::Exception const &e)>;
+
+        // Inserts count users, given an array per field, a batch of users
+        // per statement (see InsertBatch), and returns the number inserted.
+        // The users of a batch that is rejected, e.g. for a duplicate name,
+        // are inserted one at a time with Insert instead, and rejected is
+        // called for each that fails again. The users are inserted in a
+        // savepoint of their own, which nests in a caller's transaction. An
+        // error that ends the transaction is thrown, and nothing is inserted.
+        size_t Import
         (
-            Int64         id,
-            String const &password
+            size_t               count,
+            String const        *names,
+            String const        *passwords,
+            Int32 const         *roles,
+            String const        *restrictions,
+            RejectVisitor const &rejected
         );
 
-        void UpdateRestriction
+        // Sets the new password if the user has the old one, in one
+        // statement. Returns false if no user has the name and password.
+        bool UpdatePassword
+        (
+            String const &name,
+            String const &password,
+            String const &passwordNew
+        );
+
+        // Points the user at the profile of the new document and deletes
+        // the old profile if no other user has it. A profile itself is
+        // never changed. Returns false if the user does not exist.
+        bool UpdateRestriction
         (
             Int64         id,
             String const &restriction
@@ -88,15 +144,29 @@ namespace SystemStore
             String const &password
         );
 
-        void SelectRole            (Int64 id, Int32            &) const;
-        void SelectRestriction     (Int64 id, String           &) const;
+        // Fills the row in one query. The strings keep their capacity, so
+        // a row read again and again does not allocate. Returns false if
+        // there is no such user.
+        bool SelectUserRow         (Int64 id, UserRow          &) const;
+
+        // Appends up to maxCount users with ids above afterId, in id order.
+        // The restriction is only read if asked for, otherwise it is left
+        // empty. Returns the number of rows appended.
+        size_t SelectPage(Int64 afterId, Int32 maxCount, bool withRestriction, std::vector<UserRow> &rows) const;
     private:
+        // Deletes the profile if no user refers to it any more.
+        void ReleaseProfile(Int64 profileId);
+
+        RestrictionProfileTablePtr profiles;
         StatementPtr            insert;
         StatementPtr            updatePassword;
         StatementPtr            updateRestriction;
+        StatementPtr            selectProfile;
+        StatementPtr            selectProfileUsed;
         StatementPtr            selectUser;
-        StatementPtr mutable    selectRole;
-        StatementPtr mutable    selectRestriction;
+        StatementPtr mutable    selectUserRow;
+        StatementPtr mutable    selectPage;
+        StatementPtr mutable    selectPageWithRestriction;
     };
 }
 }
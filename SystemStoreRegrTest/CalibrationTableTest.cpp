@@ -0,0 +1,142 @@
+#include "stdafx.h"
+#include "TestFunction.h"
+#include <SQLiteCpp/SQLiteCpp.h>
+#include "..\SystemStore\SystemStore.h"
+#include "Common\BaseDefs.h"
+#include <iostream>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace AOI::SystemStore;
+
+//A smooth height map with a few special values, the kind of array the store is made for.
+template <class T> static std::vector<T> MakeCalibration(size_t count, T offset)
+{
+    std::vector<T> vecValues(count);
+    for ( size_t i = 0; i < count; ++ i )
+        vecValues[i] = offset + static_cast<T>(std::sin(i * 0.001) * 10.0);
+    if ( count > 100 )
+    {
+        vecValues[7]  = std::numeric_limits<T>::quiet_NaN();
+        vecValues[8]  = std::numeric_limits<T>::infinity();
+        vecValues[9]  = -std::numeric_limits<T>::infinity();
+        vecValues[10] = -static_cast<T>(0);
+        vecValues[99] = std::numeric_limits<T>::denorm_min();
+    }
+    return vecValues;
+}
+
+//Compares the bits, so NaN equals NaN and -0 differs from 0.
+template <class T> static bool SameBits(const std::vector<T> &vecA, const std::vector<T> &vecB)
+{
+    return vecA.size() == vecB.size() && ( vecA.empty() || memcmp(vecA.data(), vecB.data(), vecA.size() * sizeof(T)) == 0 );
+}
+
+template <class T> static void LoadAndCompare(SystemStore &systemStore, const String &name, const std::vector<T> &vecExpected)
+{
+    std::vector<T> vecValues;
+    __int64 version = 0;
+    int nStatus = systemStore.LoadCalibration(name, vecValues, version);
+    if ( nStatus != OK )
+        std::cout << "Failed to load calibration \"" << name << "\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to load calibration \"" << name << "\" version " << version << ", " << vecValues.size()
+                  << " values, " << ( SameBits(vecValues, vecExpected) ? "identical" : "DIFFERENT" ) << std::endl;
+}
+
+static void TestCalibrationRoundTrip()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "CALIBRATION TABLE ROUND TRIP TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    SystemStore systemStore;
+    int nStatus = OK;
+    __int64 version = 0;
+
+    //Not a multiple of the chunk size, so the last chunk is partial.
+    FloatVector vecFloats = MakeCalibration<float>(10000, 1.f);
+    nStatus = systemStore.SaveCalibration("Calib.Height", vecFloats, version);
+    if ( nStatus != OK )
+        std::cout << "Failed to save calibration \"Calib.Height\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to save calibration \"Calib.Height\" version " << version << std::endl;
+    LoadAndCompare(systemStore, "Calib.Height", vecFloats);
+
+    DoubleVector vecDoubles = MakeCalibration<double>(5000, 2.);
+    nStatus = systemStore.SaveCalibration("Calib.Distortion", vecDoubles, version);
+    if ( nStatus != OK )
+        std::cout << "Failed to save calibration \"Calib.Distortion\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to save calibration \"Calib.Distortion\" version " << version << std::endl;
+    LoadAndCompare(systemStore, "Calib.Distortion", vecDoubles);
+
+    FloatVector vecEmpty;
+    nStatus = systemStore.SaveCalibration("Calib.Empty", vecEmpty, version);
+    if ( nStatus != OK )
+        std::cout << "Failed to save calibration \"Calib.Empty\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to save calibration \"Calib.Empty\" version " << version << std::endl;
+    LoadAndCompare(systemStore, "Calib.Empty", vecEmpty);
+
+    //The smooth map must take less than its raw size.
+    SQLite::Database db(SystemStore::GetDatabaseName(), SQLite::OPEN_READONLY);
+    __int64 storedSize = db.execAndGet("select length(data) from calibration where name = 'Calib.Height';").getInt64();
+    std::cout << "Stored size of \"Calib.Height\" is less than raw size: "
+              << ( storedSize < static_cast<__int64>(vecFloats.size() * sizeof(float)) ? "yes" : "no" ) << std::endl;
+}
+
+static void TestCalibrationVersion()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "CALIBRATION TABLE VERSION TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    SystemStore systemStore;
+    int nStatus = OK;
+    __int64 version = 0;
+
+    FloatVector vecVersion1 = MakeCalibration<float>(3000, 0.f);
+    FloatVector vecVersion2 = MakeCalibration<float>(3000, 0.5f);
+    for ( auto const *pValues : { &vecVersion1, &vecVersion2 } )
+    {
+        nStatus = systemStore.SaveCalibration("Calib.Lens", *pValues, version);
+        if ( nStatus != OK )
+            std::cout << "Failed to save calibration \"Calib.Lens\", error message: " << systemStore.GetErrMsg() << std::endl;
+        else
+            std::cout << "Success to save calibration \"Calib.Lens\" version " << version << std::endl;
+    }
+
+    //The latest version is loaded by default, older ones by number.
+    LoadAndCompare(systemStore, "Calib.Lens", vecVersion2);
+
+    FloatVector vecValues;
+    nStatus = systemStore.LoadCalibration("Calib.Lens", 1, vecValues);
+    if ( nStatus != OK )
+        std::cout << "Failed to load calibration \"Calib.Lens\" version 1, error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to load calibration \"Calib.Lens\" version 1, " << ( SameBits(vecValues, vecVersion1) ? "identical" : "DIFFERENT" ) << std::endl;
+
+    nStatus = systemStore.LoadCalibration("Calib.Lens", 3, vecValues);
+    if ( nStatus != OK )
+        std::cout << "Failed to load calibration \"Calib.Lens\" version 3, error message: " << systemStore.GetErrMsg() << std::endl;
+
+    nStatus = systemStore.LoadCalibration("Calib.NeverSaved", vecValues, version);
+    if ( nStatus != OK )
+        std::cout << "Failed to load calibration \"Calib.NeverSaved\", error message: " << systemStore.GetErrMsg() << std::endl;
+
+    //A float calibration cannot be loaded as double.
+    DoubleVector vecDoubles;
+    nStatus = systemStore.LoadCalibration("Calib.Lens", vecDoubles, version);
+    if ( nStatus != OK )
+        std::cout << "Failed to load calibration \"Calib.Lens\" as double, error message: " << systemStore.GetErrMsg() << std::endl;
+}
+
+void TestCalibrationTable()
+{
+    TestCalibrationRoundTrip();
+    TestCalibrationVersion();
+}
@@ -0,0 +1,800 @@
+#include "stdafx.h"
+#include "TestFunction.h"
+#include <SQLiteCpp/SQLiteCpp.h>
+#include "..\SystemStore\SystemStore.h"
+#include "Common\BaseDefs.h"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <limits>
+
+using namespace AOI::SystemStore;
+
+static void TestMigrateParam()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "PARAM TABLE MIGRATE TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    //Create the param table with the old layout, which kept all values as text.
+    {
+        SQLite::Database db(SystemStore::GetDatabaseName(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+        db.exec("drop table if exists param;");
+        db.exec("create table param(id integer primary key asc autoincrement, name text unique not null, value text not null);");
+        db.exec("insert into param (name, value) values ('LegacyInt', '7'), ('LegacyDouble', '2.500000'), ('LegacyNegative', '-3');");
+    }
+
+    SystemStore systemStore;
+    int nStatus = OK;
+    __int32 nValue = 0;
+    double dValue = 0.;
+
+    nStatus = systemStore.GetParam("LegacyInt", nValue);
+    if ( nStatus != OK )
+        std::cout << "Failed to get param \"LegacyInt\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get param \"LegacyInt\", value: " << nValue << std::endl;
+
+    nStatus = systemStore.GetParam("LegacyDouble", dValue);
+    if ( nStatus != OK )
+        std::cout << "Failed to get param \"LegacyDouble\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get param \"LegacyDouble\", value: " << dValue << std::endl;
+
+    nStatus = systemStore.GetParam("LegacyNegative", nValue);
+    if ( nStatus != OK )
+        std::cout << "Failed to get param \"LegacyNegative\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get param \"LegacyNegative\", value: " << nValue << std::endl;
+
+    nStatus = systemStore.UpdateParam("LegacyInt", 8);
+    if ( nStatus != OK )
+        std::cout << "Failed to update param \"LegacyInt\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to update param \"LegacyInt\"" << std::endl;
+}
+
+static void TestAddParam()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "PARAM TABLE ADD PARAM TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    SystemStore systemStore;
+    int nStatus = OK;
+
+    nStatus = systemStore.AddParam("Language", 1);
+    if ( nStatus != OK )
+        std::cout << "Failed to add param \"Language\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to add param \"Language\"" << std::endl;
+
+    nStatus = systemStore.AddParam("Accuracy", 1.8);
+    if ( nStatus != OK )
+        std::cout << "Failed to add param \"Accuracy\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to add param \"Accuracy\"" << std::endl;
+
+    //Test add the duplicated param name
+    nStatus = systemStore.AddParam("Language", 2);
+    if ( nStatus != OK )
+        std::cout << "Failed to add param \"Language\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to add param \"Language\"" << std::endl;
+}
+
+static void TestParamCache()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "PARAM TABLE CACHE TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    SystemStore systemStore(SystemStore::SHARED_PARAMS);
+    int nStatus = OK;
+    __int32 nValue = 0;
+    double dValue = 0.;
+    __int64 nHits = 0, nMisses = 0;
+
+    for ( int i = 0; i < 3; ++ i )
+    {
+        nStatus = systemStore.GetParam("Language", nValue);
+        if ( nStatus != OK )
+            std::cout << "Failed to get param \"Language\", error message: " << systemStore.GetErrMsg() << std::endl;
+        else
+            std::cout << "Success to get param \"Language\", value: " << nValue << std::endl;
+    }
+
+    nStatus = systemStore.GetParam("Accuracy", dValue);
+    if ( nStatus != OK )
+        std::cout << "Failed to get param \"Accuracy\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get param \"Accuracy\", value: " << dValue << std::endl;
+
+    nStatus = systemStore.GetParam("NotExist", nValue);
+    if ( nStatus != OK )
+        std::cout << "Failed to get param \"NotExist\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get param \"NotExist\", value: " << nValue << std::endl;
+
+    systemStore.GetParamCacheStats(nHits, nMisses);
+    std::cout << "Param cache hits: " << nHits << ", misses: " << nMisses << std::endl;
+
+    //The update must invalidate the cached value.
+    nStatus = systemStore.UpdateParam("Language", 3);
+    if ( nStatus != OK )
+        std::cout << "Failed to update param \"Language\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to update param \"Language\"" << std::endl;
+
+    nStatus = systemStore.GetParam("Language", nValue);
+    if ( nStatus != OK )
+        std::cout << "Failed to get param \"Language\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get param \"Language\", value: " << nValue << std::endl;
+
+    systemStore.GetParamCacheStats(nHits, nMisses);
+    std::cout << "Param cache hits: " << nHits << ", misses: " << nMisses << std::endl;
+
+    //A write through another store must not leave the cached value of a shared store stale.
+    {
+        SystemStore otherStore;
+        nStatus = otherStore.UpdateParam("Accuracy", 2.2);
+        if ( nStatus != OK )
+            std::cout << "Failed to update param \"Accuracy\" through another store, error message: " << otherStore.GetErrMsg() << std::endl;
+        else
+            std::cout << "Success to update param \"Accuracy\" through another store" << std::endl;
+    }
+
+    nStatus = systemStore.GetParam("Accuracy", dValue);
+    if ( nStatus != OK )
+        std::cout << "Failed to get param \"Accuracy\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get param \"Accuracy\", value: " << dValue << std::endl;
+
+    systemStore.GetParamCacheStats(nHits, nMisses);
+    std::cout << "Param cache hits: " << nHits << ", misses: " << nMisses << std::endl;
+}
+
+static void TestParamPrecision()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "PARAM TABLE PRECISION TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    SystemStore systemStore;
+    int nStatus = OK;
+    __int32 nValue = 0;
+    double dValue = 0.;
+
+    nStatus = systemStore.AddParam("PixelSize", 15.123456789012);
+    if ( nStatus != OK )
+        std::cout << "Failed to add param \"PixelSize\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to add param \"PixelSize\"" << std::endl;
+
+    nStatus = systemStore.GetParam("PixelSize", dValue);
+    if ( nStatus != OK )
+        std::cout << "Failed to get param \"PixelSize\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get param \"PixelSize\", value: " << std::setprecision(15) << dValue << std::setprecision(6) << std::endl;
+
+    //Read the real param as integer and the integer param as real.
+    nStatus = systemStore.GetParam("PixelSize", nValue);
+    if ( nStatus != OK )
+        std::cout << "Failed to get param \"PixelSize\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get param \"PixelSize\" as integer, value: " << nValue << std::endl;
+
+    nStatus = systemStore.GetParam("Language", dValue);
+    if ( nStatus != OK )
+        std::cout << "Failed to get param \"Language\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get param \"Language\" as real, value: " << dValue << std::endl;
+}
+
+static void TestParamBatch()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "PARAM TABLE BATCH TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    SystemStore systemStore;
+    int nStatus = OK;
+
+    Int32ParamVector vecIntParams;
+    vecIntParams.push_back(std::make_pair("Language", 4));
+    vecIntParams.push_back(std::make_pair("LegacyInt", 9));
+    nStatus = systemStore.SetParams(vecIntParams);
+    if ( nStatus != OK )
+        std::cout << "Failed to set int params, error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to set int params" << std::endl;
+
+    DoubleParamVector vecDoubleParams;
+    vecDoubleParams.push_back(std::make_pair("Accuracy", 2.8));
+    vecDoubleParams.push_back(std::make_pair("PixelSize", 16.5));
+    nStatus = systemStore.SetParams(vecDoubleParams);
+    if ( nStatus != OK )
+        std::cout << "Failed to set double params, error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to set double params" << std::endl;
+
+    StringVector vecNames;
+    vecNames.push_back("Language");
+    vecNames.push_back("LegacyInt");
+    vecNames.push_back("Accuracy");
+    vecNames.push_back("PixelSize");
+    DoubleVector vecValues;
+    nStatus = systemStore.GetParams(vecNames, vecValues);
+    if ( nStatus != OK )
+        std::cout << "Failed to get params, error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+    {
+        std::cout << "Success to get params, values:";
+        for ( auto dValue : vecValues )
+            std::cout << " " << dValue;
+        std::cout << std::endl;
+    }
+
+    //The missing param is added by the batch.
+    vecIntParams.clear();
+    vecIntParams.push_back(std::make_pair("Language", 5));
+    vecIntParams.push_back(std::make_pair("NotExist", 1));
+    nStatus = systemStore.SetParams(vecIntParams);
+    if ( nStatus != OK )
+        std::cout << "Failed to set int params, error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to set int params" << std::endl;
+
+    vecNames.clear();
+    vecNames.push_back("Language");
+    Int32Vector vecIntValues;
+    nStatus = systemStore.GetParams(vecNames, vecIntValues);
+    if ( nStatus != OK )
+        std::cout << "Failed to get params, error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get params, value: " << vecIntValues[0] << std::endl;
+
+    vecNames.push_back("NotExist");
+    nStatus = systemStore.GetParams(vecNames, vecIntValues);
+    if ( nStatus != OK )
+        std::cout << "Failed to get params, error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get params, values: " << vecIntValues[0] << " " << vecIntValues[1] << std::endl;
+
+    vecNames.push_back("NotExist2");
+    nStatus = systemStore.GetParams(vecNames, vecIntValues);
+    if ( nStatus != OK )
+        std::cout << "Failed to get params, error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get params" << std::endl;
+}
+
+static void TestSetParam()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "PARAM TABLE SET PARAM TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    SystemStore systemStore;
+    int nStatus = OK;
+    bool bCreated = false;
+    double dValue = 0.;
+
+    nStatus = systemStore.SetParam("Exposure", 20.5, bCreated);
+    if ( nStatus != OK )
+        std::cout << "Failed to set param \"Exposure\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to set param \"Exposure\", created: " << bCreated << std::endl;
+
+    nStatus = systemStore.SetParam("Exposure", 30, bCreated);
+    if ( nStatus != OK )
+        std::cout << "Failed to set param \"Exposure\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to set param \"Exposure\", created: " << bCreated << std::endl;
+
+    nStatus = systemStore.GetParam("Exposure", dValue);
+    if ( nStatus != OK )
+        std::cout << "Failed to get param \"Exposure\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get param \"Exposure\", value: " << dValue << std::endl;
+}
+
+static void TestParamPreload()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "PARAM TABLE PRELOAD TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    int nStatus = OK;
+    __int32 nValue = 0;
+    double dValue = 0.;
+    __int64 nHits = 0, nMisses = 0;
+
+    //Enough params to make the preloaded cache grow several times.
+    {
+        SystemStore systemStore;
+        Int32ParamVector vecParams;
+        for ( int i = 0; i < 100; ++ i )
+            vecParams.emplace_back("Preload." + std::to_string(i), i * 10);
+        nStatus = systemStore.SetParams(vecParams);
+        if ( nStatus != OK )
+            std::cout << "Failed to set params, error message: " << systemStore.GetErrMsg() << std::endl;
+        else
+            std::cout << "Success to set " << vecParams.size() << " params" << std::endl;
+    }
+
+    SystemStore systemStore(SystemStore::PRELOAD_PARAMS);
+    nStatus = systemStore.GetParam("Preload.57", nValue);
+    if ( nStatus != OK )
+        std::cout << "Failed to get param \"Preload.57\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get param \"Preload.57\", value: " << nValue << std::endl;
+
+    nStatus = systemStore.GetParam("Accuracy", dValue);
+    if ( nStatus != OK )
+        std::cout << "Failed to get param \"Accuracy\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get param \"Accuracy\", value: " << dValue << std::endl;
+
+    systemStore.GetParamCacheStats(nHits, nMisses);
+    std::cout << "Param cache hits: " << nHits << ", misses: " << nMisses << std::endl;
+
+    //A param added by another store after the preload is still read from the database.
+    {
+        SystemStore otherStore;
+        nStatus = otherStore.AddParam("PreloadLate", 99);
+        if ( nStatus != OK )
+            std::cout << "Failed to add param \"PreloadLate\", error message: " << otherStore.GetErrMsg() << std::endl;
+        else
+            std::cout << "Success to add param \"PreloadLate\"" << std::endl;
+    }
+
+    nStatus = systemStore.GetParam("PreloadLate", nValue);
+    if ( nStatus != OK )
+        std::cout << "Failed to get param \"PreloadLate\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get param \"PreloadLate\", value: " << nValue << std::endl;
+
+    nStatus = systemStore.UpdateParam("Preload.57", 1);
+    if ( nStatus != OK )
+        std::cout << "Failed to update param \"Preload.57\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to update param \"Preload.57\"" << std::endl;
+
+    nStatus = systemStore.GetParam("Preload.57", nValue);
+    if ( nStatus != OK )
+        std::cout << "Failed to get param \"Preload.57\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get param \"Preload.57\", value: " << nValue << std::endl;
+
+    systemStore.GetParamCacheStats(nHits, nMisses);
+    std::cout << "Param cache hits: " << nHits << ", misses: " << nMisses << std::endl;
+}
+
+static void TestParamSubscribe()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "PARAM TABLE SUBSCRIBE TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    SystemStore systemStore;
+    int nStatus = OK;
+    __int64 nVersion = 0;
+
+    __int64 nSubscriptionId = systemStore.SubscribeParamChange(StringVector{ "Language" }, [](const String &name, __int64 version)
+    {
+        std::cout << "Param \"" << name << "\" changed, version: " << version << std::endl;
+    });
+
+    nStatus = systemStore.UpdateParam("Language", 5);
+    if ( nStatus != OK )
+        std::cout << "Failed to update param \"Language\", error message: " << systemStore.GetErrMsg() << std::endl;
+
+    //Not subscribed, so there is no callback, but the global version still changes.
+    nStatus = systemStore.UpdateParam("Accuracy", 1.5);
+    if ( nStatus != OK )
+        std::cout << "Failed to update param \"Accuracy\", error message: " << systemStore.GetErrMsg() << std::endl;
+
+    //Updating a param that does not exist changes nothing.
+    nStatus = systemStore.UpdateParam("NeverAdded", 1);
+    if ( nStatus != OK )
+        std::cout << "Failed to update param \"NeverAdded\", error message: " << systemStore.GetErrMsg() << std::endl;
+
+    std::cout << "Params version: " << systemStore.GetParamsVersion() << std::endl;
+    std::cout << "Param \"Language\" version: " << systemStore.GetParamVersion("Language") << std::endl;
+    std::cout << "Param \"Accuracy\" version: " << systemStore.GetParamVersion("Accuracy") << std::endl;
+    std::cout << "Param \"NeverAdded\" version: " << systemStore.GetParamVersion("NeverAdded") << std::endl;
+
+    nStatus = systemStore.WaitParamChange(StringVector{ "Language" }, systemStore.GetParamVersion("Language"), 0, nVersion);
+    std::cout << "Wait for \"Language\" without a change, status: " << nStatus << std::endl;
+
+    //Another thread waits for the change of a batch.
+    __int64 nSince = systemStore.GetParamsVersion();
+    int nWaitStatus = NOK;
+    __int64 nWaitVersion = 0;
+    std::thread waiter([&]()
+    {
+        nWaitStatus = systemStore.WaitParamChange(StringVector{ "Exposure", "Gain" }, nSince, 10000, nWaitVersion);
+    });
+
+    DoubleParamVector vecParams{ { "Exposure", 25. }, { "Gain", 1.25 } };
+    nStatus = systemStore.SetParams(vecParams);
+    if ( nStatus != OK )
+        std::cout << "Failed to set params, error message: " << systemStore.GetErrMsg() << std::endl;
+    waiter.join();
+    std::cout << "Wait for \"Exposure\" and \"Gain\", status: " << nWaitStatus << ", version: " << nWaitVersion << std::endl;
+
+    systemStore.UnsubscribeParamChange(nSubscriptionId);
+    nStatus = systemStore.UpdateParam("Language", 6);
+    if ( nStatus != OK )
+        std::cout << "Failed to update param \"Language\", error message: " << systemStore.GetErrMsg() << std::endl;
+    std::cout << "Params version: " << systemStore.GetParamsVersion() << std::endl;
+}
+
+static void TestParamsUnder()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "PARAM TABLE PREFIX SCAN TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    SystemStore systemStore;
+    int nStatus = OK;
+
+    DoubleParamVector vecParams{ { "camera.1.exposure", 12. }, { "camera.0.gain", 1.5 }, { "camera.0.exposure", 10. },
+        { "camera.0", 1. }, { "camera.0.exposure.max", 40. }, { "conveyor.speed", 300. } };
+    nStatus = systemStore.SetParams(vecParams);
+    if ( nStatus != OK )
+        std::cout << "Failed to set params, error message: " << systemStore.GetErrMsg() << std::endl;
+
+    DoubleParamVector vecResult;
+    nStatus = systemStore.GetParamsUnder("camera.0.", vecResult);
+    if ( nStatus != OK )
+        std::cout << "Failed to get params under \"camera.0.\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+    {
+        std::cout << "Success to get " << vecResult.size() << " params under \"camera.0.\"" << std::endl;
+        for ( const auto &param : vecResult )
+            std::cout << "  " << param.first << " = " << param.second << std::endl;
+    }
+
+    Int32ParamVector vecIntResult;
+    nStatus = systemStore.GetParamsUnder("nothing.", vecIntResult);
+    if ( nStatus != OK )
+        std::cout << "Failed to get params under \"nothing.\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get " << vecIntResult.size() << " params under \"nothing.\"" << std::endl;
+
+    //Streaming, stopped after the second param.
+    int nVisited = 0;
+    nStatus = systemStore.ForEachParamUnder("camera.", [&nVisited](const String &name, double value)
+    {
+        std::cout << "  " << name << " = " << value << std::endl;
+        return ++ nVisited < 2;
+    });
+    if ( nStatus != OK )
+        std::cout << "Failed to scan params under \"camera.\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to scan " << nVisited << " params under \"camera.\"" << std::endl;
+}
+
+static void PrintStatementCacheDelta(SystemStore &systemStore, __int64 &nHits, __int64 &nMisses)
+{
+    __int64 nNewHits = 0, nNewMisses = 0, nEvictions = 0, nCompileUs = 0;
+    systemStore.GetStatementCacheStats(nNewHits, nNewMisses, nEvictions, nCompileUs);
+    std::cout << "  statement cache hits: " << nNewHits - nHits << ", misses: " << nNewMisses - nMisses << std::endl;
+    nHits   = nNewHits;
+    nMisses = nNewMisses;
+}
+
+static void TestStatementCache()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "PARAM TABLE STATEMENT CACHE TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    SystemStore systemStore;
+    __int64 nHits = 0, nMisses = 0, nEvictions = 0, nCompileUs = 0;
+    systemStore.GetStatementCacheStats(nHits, nMisses, nEvictions, nCompileUs);
+
+    //The scan is compiled once.
+    DoubleParamVector vecResult;
+    for ( int i = 0; i < 3; ++ i )
+        systemStore.GetParamsUnder("camera.0.", vecResult);
+    std::cout << "Three scans of " << vecResult.size() << " params:" << std::endl;
+    PrintStatementCacheDelta(systemStore, nHits, nMisses);
+
+    //A scan stopped early is reused as well.
+    int nVisited = 0;
+    for ( int i = 0; i < 2; ++ i )
+        systemStore.ForEachParamUnder("camera.", [&nVisited](const String &, double) { return ++ nVisited % 2 != 0; });
+    std::cout << "Two scans stopped after " << nVisited / 2 << " params:" << std::endl;
+    PrintStatementCacheDelta(systemStore, nHits, nMisses);
+
+    //A visitor starting the same scan gets a statement of its own.
+    size_t nInner = 0;
+    nVisited = 0;
+    int nStatus = systemStore.ForEachParamUnder("camera.", [&](const String &, double)
+    {
+        DoubleParamVector vecInner;
+        systemStore.GetParamsUnder("camera.", vecInner);
+        nInner += vecInner.size();
+        ++ nVisited;
+        return true;
+    });
+    if ( nStatus != OK )
+        std::cout << "Failed to scan params under \"camera.\", error message: " << systemStore.GetErrMsg() << std::endl;
+    std::cout << "Nested scans, outer " << nVisited << " params, inner " << nInner << " params:" << std::endl;
+    PrintStatementCacheDelta(systemStore, nHits, nMisses);
+}
+
+static void TestBinaryParam()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "PARAM TABLE BINARY TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    SystemStore systemStore;
+    int nStatus = OK;
+
+    Binary vecMatrix;
+    for ( int i = 0; i < 64; ++ i )
+        vecMatrix.push_back(static_cast<unsigned char>(i * 3));
+    nStatus = systemStore.AddParam("Calibration.Matrix", vecMatrix);
+    if ( nStatus != OK )
+        std::cout << "Failed to add param \"Calibration.Matrix\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to add param \"Calibration.Matrix\"" << std::endl;
+
+    Binary vecRead;
+    nStatus = systemStore.GetParam("Calibration.Matrix", vecRead);
+    if ( nStatus != OK )
+        std::cout << "Failed to get param \"Calibration.Matrix\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get param \"Calibration.Matrix\", size: " << vecRead.size() << ", equal: " << (vecRead == vecMatrix) << std::endl;
+
+    unsigned char arrBuffer[100];
+    size_t nSize = 0;
+    nStatus = systemStore.GetParam("Calibration.Matrix", arrBuffer, 32, nSize);
+    if ( nStatus != OK )
+        std::cout << "Failed to get param \"Calibration.Matrix\" into 32 bytes, size: " << nSize << ", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get param \"Calibration.Matrix\" into 32 bytes, size: " << nSize << std::endl;
+
+    nStatus = systemStore.GetParam("Calibration.Matrix", arrBuffer, sizeof(arrBuffer), nSize);
+    if ( nStatus != OK )
+        std::cout << "Failed to get param \"Calibration.Matrix\" into 100 bytes, error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get param \"Calibration.Matrix\" into 100 bytes, size: " << nSize << ", last byte: " << static_cast<int>(arrBuffer[nSize - 1]) << std::endl;
+
+    nStatus = systemStore.ViewParam("Calibration.Matrix", [&systemStore](const void *data, size_t size)
+    {
+        std::cout << "Viewing param \"Calibration.Matrix\", size: " << size << ", second byte: " << static_cast<int>(static_cast<const unsigned char *>(data)[1]) << std::endl;
+
+        //Reading the store meanwhile must leave the viewed buffer alone.
+        Binary vecInner;
+        __int32 nInner = 0;
+        systemStore.GetParam("Calibration.Matrix", vecInner);
+        systemStore.GetParam("Calibration.Matrix", nInner);
+        std::cout << "Read again while viewing, equal: " << ( vecInner == Binary(static_cast<const unsigned char *>(data), static_cast<const unsigned char *>(data) + size) ) << std::endl;
+    });
+    if ( nStatus != OK )
+        std::cout << "Failed to view param \"Calibration.Matrix\", error message: " << systemStore.GetErrMsg() << std::endl;
+
+    //A binary param has no number, and a number has no bytes.
+    __int32 nValue = 0;
+    nStatus = systemStore.GetParam("Calibration.Matrix", nValue);
+    if ( nStatus != OK )
+        std::cout << "Failed to get param \"Calibration.Matrix\" as a number, error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get param \"Calibration.Matrix\" as a number, value: " << nValue << std::endl;
+
+    nStatus = systemStore.GetParam("Language", vecRead);
+    if ( nStatus != OK )
+        std::cout << "Failed to get param \"Language\" as binary, error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get param \"Language\" as binary, size: " << vecRead.size() << std::endl;
+
+    bool bCreated = false;
+    nStatus = systemStore.SetParam("Calibration.Matrix", Binary(), bCreated);
+    if ( nStatus != OK )
+        std::cout << "Failed to set param \"Calibration.Matrix\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to set param \"Calibration.Matrix\", created: " << bCreated << std::endl;
+
+    nStatus = systemStore.GetParam("Calibration.Matrix", vecRead);
+    if ( nStatus != OK )
+        std::cout << "Failed to get param \"Calibration.Matrix\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get param \"Calibration.Matrix\", size: " << vecRead.size() << std::endl;
+
+    nStatus = systemStore.UpdateParam("Binary.NeverAdded", Binary(4, 1));
+    if ( nStatus != OK )
+        std::cout << "Failed to update param \"Binary.NeverAdded\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to update param \"Binary.NeverAdded\"" << std::endl;
+}
+
+static void PrintParamHistory(SystemStore &systemStore, const String &name)
+{
+    ParamChangeVector vecChanges;
+    int nStatus = systemStore.GetParamHistory(name, 0, std::numeric_limits<__int64>::max(), vecChanges);
+    if ( nStatus != OK )
+    {
+        std::cout << "Failed to get history of param \"" << name << "\", error message: " << systemStore.GetErrMsg() << std::endl;
+        return;
+    }
+
+    std::cout << "Success to get " << vecChanges.size() << " changes of param \"" << name << "\"" << std::endl;
+    for ( size_t i = 0; i < vecChanges.size(); ++ i )
+    {
+        const ParamChange &change = vecChanges[i];
+        std::cout << "  by \"" << change.userName << "\": ";
+        if ( change.hasOldValue ) std::cout << change.oldValue; else std::cout << "none";
+        std::cout << " -> ";
+        if ( change.hasNewValue ) std::cout << change.newValue; else std::cout << "none";
+        std::cout << ", in order: " << ( i == 0 || vecChanges[i - 1].time <= change.time ) << std::endl;
+    }
+}
+
+static void TestParamHistory()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "PARAM TABLE HISTORY TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    SystemStore systemStore;
+    int nStatus = OK;
+    bool bCreated = false;
+
+    nStatus = systemStore.AddParam("History.Speed", 100);
+    if ( nStatus != OK )
+        std::cout << "Failed to add param \"History.Speed\", error message: " << systemStore.GetErrMsg() << std::endl;
+
+    __int64 Id = 0;
+    nStatus = systemStore.UserLogin("Op", "Operator", Id);
+    if ( nStatus != OK )
+        std::cout << "Failed to log in, error message: " << systemStore.GetErrMsg() << std::endl;
+
+    nStatus = systemStore.UpdateParam("History.Speed", 120.5);
+    if ( nStatus != OK )
+        std::cout << "Failed to update param \"History.Speed\", error message: " << systemStore.GetErrMsg() << std::endl;
+
+    nStatus = systemStore.SetParam("History.Speed", 130, bCreated);
+    if ( nStatus != OK )
+        std::cout << "Failed to set param \"History.Speed\", error message: " << systemStore.GetErrMsg() << std::endl;
+
+    Int32ParamVector vecParams{ { "History.Speed", 140 }, { "History.Gain", 2 } };
+    nStatus = systemStore.SetParams(vecParams);
+    if ( nStatus != OK )
+        std::cout << "Failed to set params, error message: " << systemStore.GetErrMsg() << std::endl;
+
+    //A failed write is not logged.
+    nStatus = systemStore.AddParam("History.Speed", 150);
+    if ( nStatus != OK )
+        std::cout << "Failed to add param \"History.Speed\", error message: " << systemStore.GetErrMsg() << std::endl;
+
+    nStatus = systemStore.UpdateParam("History.NeverAdded", 1);
+    if ( nStatus != OK )
+        std::cout << "Failed to update param \"History.NeverAdded\", error message: " << systemStore.GetErrMsg() << std::endl;
+
+    //Binary values are not kept.
+    nStatus = systemStore.SetParam("History.Table", Binary(1000, 7), bCreated);
+    if ( nStatus != OK )
+        std::cout << "Failed to set param \"History.Table\", error message: " << systemStore.GetErrMsg() << std::endl;
+
+    PrintParamHistory(systemStore, "History.Speed");
+    PrintParamHistory(systemStore, "History.Gain");
+    PrintParamHistory(systemStore, "History.NeverAdded");
+    PrintParamHistory(systemStore, "History.Table");
+
+    //A time range in the past has no changes.
+    ParamChangeVector vecChanges;
+    nStatus = systemStore.GetParamHistory("History.Speed", 0, 1000, vecChanges);
+    if ( nStatus != OK )
+        std::cout << "Failed to get history, error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to get " << vecChanges.size() << " changes of param \"History.Speed\" before 1970-01-01 00:00:01" << std::endl;
+}
+
+static void PrintBatchParams(SystemStore &systemStore)
+{
+    for ( const char *name : { "Batch.A", "Batch.B" } )
+    {
+        Int32 nValue = 0;
+        if ( systemStore.GetParam(name, nValue) != OK )
+            std::cout << "Failed to get param \"" << name << "\", error message: " << systemStore.GetErrMsg() << std::endl;
+        else
+            std::cout << "  " << name << ": " << nValue << std::endl;
+    }
+}
+
+static void TestBatchScope()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "PARAM TABLE BATCH SCOPE TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    SystemStore systemStore;
+    int nStatus = systemStore.SetParams(Int32ParamVector{ { "Batch.A", 1 }, { "Batch.B", 1 } });
+    if ( nStatus != OK )
+        std::cout << "Failed to set params, error message: " << systemStore.GetErrMsg() << std::endl;
+
+    //The store's own transaction of SetParams nests in the batch. The
+    //changes are notified at the commit, with one version.
+    __int64 nVersion = systemStore.GetParamsVersion();
+    {
+        SystemStore::Batch batch(systemStore);
+        systemStore.UpdateParam("Batch.A", 2);
+        systemStore.SetParams(Int32ParamVector{ { "Batch.B", 2 } });
+        std::cout << "Version changed before the commit: " << ( systemStore.GetParamsVersion() != nVersion ? "yes" : "no" ) << std::endl;
+        nStatus = batch.Commit();
+        if ( nStatus != OK )
+            std::cout << "Failed to commit batch, error message: " << systemStore.GetErrMsg() << std::endl;
+    }
+    std::cout << "Versions added by the commit: " << systemStore.GetParamsVersion() - nVersion << std::endl;
+    {
+        SystemStore otherStore;
+        std::cout << "Committed, read by another store:" << std::endl;
+        PrintBatchParams(otherStore);
+    }
+
+    //Without a commit the writes are undone, also those read back into the cache.
+    nVersion = systemStore.GetParamsVersion();
+    {
+        SystemStore::Batch batch(systemStore);
+        systemStore.UpdateParam("Batch.A", 3);
+        std::cout << "Inside the batch:" << std::endl;
+        PrintBatchParams(systemStore);
+    }
+    std::cout << "Not committed, version changed: " << ( systemStore.GetParamsVersion() != nVersion ? "yes" : "no" ) << std::endl;
+    PrintBatchParams(systemStore);
+
+    //An inner batch is undone alone. A failed call does not end the outer one.
+    {
+        SystemStore::Batch outer(systemStore);
+        systemStore.UpdateParam("Batch.A", 4);
+        {
+            SystemStore::Batch inner(systemStore);
+            systemStore.UpdateParam("Batch.B", 4);
+        }
+        nStatus = systemStore.AddParam("Batch.A", 5);
+        if ( nStatus != OK )
+            std::cout << "Failed to add param \"Batch.A\" again, error message: " << systemStore.GetErrMsg() << std::endl;
+        nStatus = outer.Commit();
+        if ( nStatus != OK )
+            std::cout << "Failed to commit batch, error message: " << systemStore.GetErrMsg() << std::endl;
+    }
+    std::cout << "Outer committed, inner not:" << std::endl;
+    PrintBatchParams(systemStore);
+}
+
+void TestParamTable()
+{
+    TestMigrateParam();
+    TestAddParam();
+    TestParamCache();
+    TestParamPrecision();
+    TestParamBatch();
+    TestSetParam();
+    TestParamPreload();
+    TestParamSubscribe();
+    TestParamsUnder();
+    TestStatementCache();
+    TestBinaryParam();
+    TestParamHistory();
+    TestBatchScope();
+}
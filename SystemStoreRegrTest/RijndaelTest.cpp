@@ -0,0 +1,222 @@
+#include "stdafx.h"
+#include "TestFunction.h"
+#include "..\SystemStore\Rijndael.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+static const int ALL_PATHS[] = { CRijndael::PATH_TABLE, CRijndael::PATH_SSSE3, CRijndael::PATH_AESNI };
+
+static std::string FromHex(const std::string &hex)
+{
+    std::string bytes;
+    for ( size_t i = 0; i + 1 < hex.size(); i += 2 )
+        bytes.push_back(static_cast<char>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+    return bytes;
+}
+
+//The known answer tests of FIPS-197 appendix C, on every path the CPU supports.
+static void TestKnownAnswer(const char *name, const std::string &key, const std::string &plain, const std::string &cipher)
+{
+    CRijndael rijndael;
+    rijndael.MakeKey(key.data(), CRijndael::sm_chain0, static_cast<int>(key.size()), 16);
+
+    int nFailed = 0;
+    for ( int path : ALL_PATHS )
+    {
+        if ( ! CRijndael::IsPathSupported(path) )
+            continue;
+
+        rijndael.SetPath(path);
+        char result[16], back[16];
+        rijndael.EncryptBlock(plain.data(), result);
+        rijndael.DecryptBlock(result, back);
+        if ( std::string(result, 16) != cipher || std::string(back, 16) != plain )
+        {
+            std::cout << name << " known answer failed on path " << path << std::endl;
+            ++ nFailed;
+        }
+    }
+    if ( nFailed == 0 )
+        std::cout << "Success " << name << " known answer on all supported paths" << std::endl;
+}
+
+//Random keys and blocks, every path against the table path.
+static void TestPathsAgree(int keyLength, int nKeys, int nBlocks)
+{
+    std::mt19937 generator(static_cast<unsigned>(keyLength));
+    std::uniform_int_distribution<int> byte(0, 255);
+    int nFailed = 0;
+
+    for ( int k = 0; k < nKeys; ++ k )
+    {
+        std::string key(keyLength, '\0');
+        for ( auto &c : key )
+            c = static_cast<char>(byte(generator));
+
+        CRijndael rijndael;
+        rijndael.MakeKey(key.data(), CRijndael::sm_chain0, keyLength, 16);
+        for ( int b = 0; b < nBlocks; ++ b )
+        {
+            char block[16], expected[16], expectedBack[16];
+            for ( auto &c : block )
+                c = static_cast<char>(byte(generator));
+
+            rijndael.SetPath(CRijndael::PATH_TABLE);
+            rijndael.EncryptBlock(block, expected);
+            rijndael.DecryptBlock(block, expectedBack);
+            for ( int path : ALL_PATHS )
+            {
+                if ( ! CRijndael::IsPathSupported(path) )
+                    continue;
+
+                char result[16], back[16];
+                rijndael.SetPath(path);
+                rijndael.EncryptBlock(block, result);
+                rijndael.DecryptBlock(block, back);
+                if ( memcmp(result, expected, 16) != 0 || memcmp(back, expectedBack, 16) != 0 )
+                    ++ nFailed;
+            }
+        }
+    }
+
+    if ( nFailed != 0 )
+        std::cout << "Failed " << nFailed << " blocks with " << keyLength * 8 << "-bit keys" << std::endl;
+    else
+        std::cout << "Success " << nKeys * nBlocks << " random blocks with " << keyLength * 8 << "-bit keys agree on all supported paths" << std::endl;
+}
+
+//NIST SP 800-38A F.5.1, whole and in chunks of odd sizes that split blocks.
+static void TestCtrKnownAnswer()
+{
+    const std::string key     = FromHex("2b7e151628aed2a6abf7158809cf4f3c");
+    const std::string counter = FromHex("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff");
+    const std::string plain   = FromHex("6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+                                        "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710");
+    const std::string cipher  = FromHex("874d6191b620e3261bef6864990db6ce9806f66b7970fdff8617187bb9fffdff"
+                                        "5ae4df3edbd5d35e5b4f09020db03eab1e031dda2fbe03d1792170a0f3009cee");
+    const size_t chunks[] = { 1, 7, 16, 9, 31 };
+
+    CRijndael rijndael;
+    rijndael.MakeKey(key.data(), counter.data(), 16, 16);
+    int nFailed = 0;
+    for ( int path : ALL_PATHS )
+    {
+        if ( ! CRijndael::IsPathSupported(path) )
+            continue;
+
+        rijndael.SetPath(path);
+        std::string result(plain.size(), '\0');
+        rijndael.ResetChain();
+        rijndael.Encrypt(plain.data(), &result[0], plain.size(), CRijndael::CTR);
+        if ( result != cipher )
+            ++ nFailed;
+
+        std::string back(plain.size(), '\0');
+        rijndael.ResetChain();
+        size_t offset = 0;
+        for ( size_t chunk : chunks )
+        {
+            rijndael.Decrypt(cipher.data() + offset, &back[offset], chunk, CRijndael::CTR);
+            offset += chunk;
+        }
+        if ( offset != plain.size() || back != plain )
+            ++ nFailed;
+    }
+    if ( nFailed != 0 )
+        std::cout << "Failed CTR known answer, " << nFailed << " mismatches" << std::endl;
+    else
+        std::cout << "Success CTR known answer, whole and in chunks, on all supported paths" << std::endl;
+
+    //The counter carries across the low 64 bits.
+    const std::string carryCounter = FromHex("00000000000000ffffffffffffffffff");
+    const std::string zeros(48, '\0');
+    std::string result(zeros.size(), '\0');
+    rijndael.EncryptCtr(carryCounter.data(), 0, zeros.data(), &result[0], zeros.size());
+    std::cout << ( result == FromHex("dacc9148febbffe342d5805537ea155ff644566de02f529aa57d9a6064ac0ab681bca66820a2754afa4e7b135caed7a9")
+                   ? "Success" : "Failed" ) << " CTR counter carry" << std::endl;
+}
+
+//Inputs above CTR_PARALLEL_SIZE may be split across threads, and the
+//result must not depend on it.
+static void TestCtrLarge()
+{
+    const size_t nBytes = 3 * CRijndael::CTR_PARALLEL_SIZE + 5;
+    std::string plain(nBytes, '\0');
+    for ( size_t i = 0; i < nBytes; ++ i )
+        plain[i] = static_cast<char>(i * 31 + 7);
+
+    CRijndael rijndael;
+    rijndael.MakeKey(FromHex("000102030405060708090a0b0c0d0e0f").data(), FromHex("0123456789abcdef0123456789abcdef").data(), 16, 16);
+    std::string whole(nBytes, '\0');
+    rijndael.Encrypt(plain.data(), &whole[0], nBytes, CRijndael::CTR);
+
+    int nFailed = 0;
+    for ( int path : ALL_PATHS )
+    {
+        if ( ! CRijndael::IsPathSupported(path) )
+            continue;
+
+        rijndael.SetPath(path);
+        rijndael.ResetChain();
+        std::string chunked(nBytes, '\0');
+        for ( size_t offset = 0; offset < nBytes; offset += 4099 )
+            rijndael.Encrypt(plain.data() + offset, &chunked[offset], std::min<size_t>(4099, nBytes - offset), CRijndael::CTR);
+        if ( chunked != whole )
+            ++ nFailed;
+    }
+
+    std::string back(nBytes, '\0');
+    rijndael.ResetChain();
+    rijndael.Decrypt(whole.data(), &back[0], nBytes, CRijndael::CTR);
+    if ( back != plain )
+        ++ nFailed;
+
+    if ( nFailed != 0 )
+        std::cout << "Failed CTR of " << nBytes << " bytes, " << nFailed << " mismatches" << std::endl;
+    else
+        std::cout << "Success CTR of " << nBytes << " bytes matches chunked CTR on all supported paths" << std::endl;
+}
+
+void TestRijndael()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "RIJNDAEL BLOCK PATH TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    const std::string plain = FromHex("00112233445566778899aabbccddeeff");
+    TestKnownAnswer("AES-128", FromHex("000102030405060708090a0b0c0d0e0f"), plain,
+        FromHex("69c4e0d86a7b0430d8cdb78070b4c55a"));
+    TestKnownAnswer("AES-192", FromHex("000102030405060708090a0b0c0d0e0f1011121314151617"), plain,
+        FromHex("dda97ca4864cdfe06eaf70a0ec0d7191"));
+    TestKnownAnswer("AES-256", FromHex("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"), plain,
+        FromHex("8ea2b7ca516745bfeafc49904b496089"));
+
+    TestPathsAgree(16, 100, 100);
+    TestPathsAgree(24, 100, 100);
+    TestPathsAgree(32, 100, 100);
+    TestCtrKnownAnswer();
+    TestCtrLarge();
+
+    //MakeKey prefers the constant time paths.
+    CRijndael rijndael;
+    rijndael.MakeKey(FromHex("000102030405060708090a0b0c0d0e0f").data(), CRijndael::sm_chain0, 16, 16);
+    int bestPath = CRijndael::IsPathSupported(CRijndael::PATH_AESNI) ? CRijndael::PATH_AESNI
+                 : CRijndael::IsPathSupported(CRijndael::PATH_SSSE3) ? CRijndael::PATH_SSSE3 : CRijndael::PATH_TABLE;
+    std::cout << "Default path is AES-NI, else SSSE3, else table: " << ( rijndael.GetPath() == bestPath ? "yes" : "no" ) << std::endl;
+
+    //Blocks other than 128-bit only have the table path.
+    rijndael.MakeKey(FromHex("000102030405060708090a0b0c0d0e0f").data(), CRijndael::sm_chain0, 16, 32);
+    try
+    {
+        rijndael.SetPath(CRijndael::PATH_SSSE3);
+        std::cout << "Success to select the SSSE3 path for 256-bit blocks" << std::endl;
+    }
+    catch ( std::exception &e )
+    {
+        std::cout << "Failed to select the SSSE3 path for 256-bit blocks, error message: " << e.what() << std::endl;
+    }
+}
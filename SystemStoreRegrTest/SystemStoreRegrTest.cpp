@@ -7,5 +7,8 @@
 int _tmain(int argc, _TCHAR* argv[])
 {
     TestUserTable();
+    TestParamTable();
+    TestCalibrationTable();
+    TestRijndael();
 	return 0;
 }
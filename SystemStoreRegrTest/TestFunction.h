@@ -3,5 +3,8 @@
 #define _TEST_FUNCTION_H_
 
 void TestUserTable();
+void TestParamTable();
+void TestCalibrationTable();
+void TestRijndael();
 
 #endif
\ No newline at end of file
@@ -1,9 +1,12 @@
 // TestSystemStore.cpp : Defines the entry point for the console application.
 
 #include "stdafx.h"
+#include <SQLiteCpp/SQLiteCpp.h>
 #include "..\SystemStore\SystemStore.h"
 #include "Common\BaseDefs.h"
 #include <iostream>
+#include <thread>
+#include <chrono>
 
 using namespace AOI::SystemStore;
 
@@ -118,6 +121,15 @@ void TestUpdatePassword()
     else
         std::cout << "Success to update password" << std::endl;
 
+    //The old password is no longer the current one.
+    nStatus = systemStore.UpdatePassword("Engineer", "Engineer", "Engineer");
+    if ( nStatus != OK )
+        std::cout << "Failed to update password with a wrong old password, error message: " << systemStore.GetErrMsg() << std::endl;
+
+    nStatus = systemStore.UpdatePassword("NoSuchUser", "Engineer", "Engineer");
+    if ( nStatus != OK )
+        std::cout << "Failed to update password of an unknown user, error message: " << systemStore.GetErrMsg() << std::endl;
+
     nStatus = systemStore.UserLogin("Engineer", "Engineer", Id);
     if ( nStatus != OK )
         std::cout << "Failed to log in use old password, error message: " << systemStore.GetErrMsg() << std::endl;
@@ -144,6 +156,451 @@ void TestUpdatePassword()
         std::cout << "Role: " << static_cast<__int32>(role) << std::endl;
         std::cout << "Restriction: " << restriction << std::endl;
     }
+
+    nStatus = systemStore.GetUserRoleAndRestriction(Id + 1000, role, restriction );
+    if ( nStatus != OK )
+        std::cout << "Failed to get role and restriction of an unknown user, error message: " << systemStore.GetErrMsg() << std::endl;
+}
+
+static void TestSession()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "USER TABLE SESSION TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    SystemStore systemStore;
+    __int64 Id = 0;
+    int nStatus = OK;
+    AOI::String token, tokenAdmin;
+
+    nStatus = systemStore.UserLogin("Op", "Operator", Id, token);
+    if ( nStatus != OK )
+        std::cout << "Failed to log in, error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success log in, user ID: " << Id << ", token length: " << token.size() << std::endl;
+
+    AOI::String userName;
+    nStatus = systemStore.ValidateSession(token, Id, userName);
+    if ( nStatus != OK )
+        std::cout << "Failed to validate session, error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to validate session, user ID: " << Id << ", user name: " << userName << std::endl;
+
+    //A failed login issues no token.
+    nStatus = systemStore.UserLogin("Op", "Wrong", Id, tokenAdmin);
+    if ( nStatus != OK )
+        std::cout << "Failed to log in, token is empty: " << ( tokenAdmin.empty() ? "yes" : "no" ) << std::endl;
+
+    nStatus = systemStore.ValidateSession("NotAToken", Id);
+    if ( nStatus != OK )
+        std::cout << "Failed to validate session \"NotAToken\", error message: " << systemStore.GetErrMsg() << std::endl;
+
+    //Updating the password ends the user's sessions only.
+    nStatus = systemStore.UserLogin("Admin", "Admin", Id, tokenAdmin);
+    if ( nStatus != OK )
+        std::cout << "Failed to log in, error message: " << systemStore.GetErrMsg() << std::endl;
+
+    nStatus = systemStore.UpdatePassword("Op", "Operator", "Operator2");
+    if ( nStatus != OK )
+        std::cout << "Failed to update password, error message: " << systemStore.GetErrMsg() << std::endl;
+
+    nStatus = systemStore.ValidateSession(token, Id);
+    if ( nStatus != OK )
+        std::cout << "Failed to validate session after password update, error message: " << systemStore.GetErrMsg() << std::endl;
+
+    nStatus = systemStore.ValidateSession(tokenAdmin, Id);
+    if ( nStatus != OK )
+        std::cout << "Failed to validate session of \"Admin\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to validate session of \"Admin\", user ID: " << Id << std::endl;
+
+    nStatus = systemStore.UpdatePassword("Op", "Operator2", "Operator");
+    if ( nStatus != OK )
+        std::cout << "Failed to update password, error message: " << systemStore.GetErrMsg() << std::endl;
+
+    systemStore.EndSession(tokenAdmin);
+    nStatus = systemStore.ValidateSession(tokenAdmin, Id);
+    if ( nStatus != OK )
+        std::cout << "Failed to validate ended session, error message: " << systemStore.GetErrMsg() << std::endl;
+
+    //Validating keeps a session alive, idling past the timeout ends it. The
+    //margins are wide so a slow machine does not expire the session early.
+    systemStore.SetSessionTimeout(2000);
+    nStatus = systemStore.UserLogin("Op", "Operator", Id, token);
+    if ( nStatus != OK )
+        std::cout << "Failed to log in, error message: " << systemStore.GetErrMsg() << std::endl;
+
+    for ( int i = 0; i < 3; ++ i )
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        nStatus = systemStore.ValidateSession(token, Id);
+        if ( nStatus != OK )
+            std::cout << "Failed to validate active session, error message: " << systemStore.GetErrMsg() << std::endl;
+    }
+    std::cout << "Success to keep session alive for 1500 ms" << std::endl;
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(6000));
+    nStatus = systemStore.ValidateSession(token, Id);
+    if ( nStatus != OK )
+        std::cout << "Failed to validate idle session, error message: " << systemStore.GetErrMsg() << std::endl;
+}
+
+static void TestImportUsers()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "USER TABLE IMPORT USERS TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    SystemStore systemStore;
+    StringVector errors;
+
+    //"Op" exists already and "Line_B" is in the list twice.
+    UserImportVector users;
+    for ( const char *name : { "Line_A", "Op", "Line_B", "Line_B", "Line_C" } )
+    {
+        UserImport user = { name, AOI::String(name) + "_pw", UserRole::OPERATOR, TEST_RESTRICTION };
+        users.push_back(user);
+    }
+    int nStatus = systemStore.ImportUsers(users, errors);
+    if ( nStatus != OK )
+        std::cout << "Failed to import all users, error message: " << systemStore.GetErrMsg() << std::endl;
+    for ( size_t i = 0; i < users.size(); ++ i )
+        std::cout << "  " << users[i].name << ": " << ( errors[i].empty() ? "imported" : errors[i] ) << std::endl;
+
+    __int64 Id = 0;
+    nStatus = systemStore.UserLogin("Line_C", "Line_C_pw", Id);
+    if ( nStatus != OK )
+        std::cout << "Failed to log in \"Line_C\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to log in \"Line_C\"" << std::endl;
+
+    //Large enough to take several insert batches, and for the passwords to
+    //be encrypted on several threads.
+    users.clear();
+    for ( int i = 0; i < 5000; ++ i )
+    {
+        UserImport user = { "Bulk_" + std::to_string(i), "Bulk_pw_" + std::to_string(i), UserRole::OPERATOR, "" };
+        users.push_back(user);
+    }
+    nStatus = systemStore.ImportUsers(users, errors);
+    if ( nStatus != OK )
+        std::cout << "Failed to import " << users.size() << " users, error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to import " << users.size() << " users" << std::endl;
+
+    for ( const char *name : { "Bulk_0", "Bulk_2500", "Bulk_4999" } )
+    {
+        nStatus = systemStore.UserLogin(name, AOI::String("Bulk_pw_") + ( name + 5 ), Id);
+        if ( nStatus != OK )
+            std::cout << "Failed to log in \"" << name << "\", error message: " << systemStore.GetErrMsg() << std::endl;
+        else
+            std::cout << "Success to log in \"" << name << "\"" << std::endl;
+    }
+
+    //Several insert batches, one with a user that exists already.
+    users.clear();
+    for ( int i = 0; i < 600; ++ i )
+    {
+        UserImport user = { "Batch_" + std::to_string(i), "Batch_pw", UserRole::OPERATOR, TEST_RESTRICTION };
+        users.push_back(user);
+    }
+    users[300].name = "Bulk_0";
+    nStatus = systemStore.ImportUsers(users, errors);
+    if ( nStatus != OK )
+        std::cout << "Failed to import all users, error message: " << systemStore.GetErrMsg() << std::endl;
+    for ( size_t i = 0; i < users.size(); ++ i )
+        if ( ! errors[i].empty() )
+            std::cout << "  " << i << " " << users[i].name << ": " << errors[i] << std::endl;
+
+    for ( const char *name : { "Batch_0", "Batch_299", "Batch_301", "Batch_599" } )
+    {
+        nStatus = systemStore.UserLogin(name, "Batch_pw", Id);
+        if ( nStatus != OK )
+            std::cout << "Failed to log in \"" << name << "\", error message: " << systemStore.GetErrMsg() << std::endl;
+        else
+            std::cout << "Success to log in \"" << name << "\"" << std::endl;
+    }
+}
+
+static void TestListUsers()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "USER TABLE LIST USERS TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    SystemStore systemStore;
+    UserInfoVector users;
+    int nStatus = systemStore.ListUsers(0, 3, false, users);
+    if ( nStatus != OK )
+        std::cout << "Failed to list users, error message: " << systemStore.GetErrMsg() << std::endl;
+    for ( auto const &user : users )
+        std::cout << "  " << user.Id << " " << user.name << ", role " << static_cast<__int32>(user.role)
+                  << ", restriction " << ( user.restriction.empty() ? "not read" : "read" ) << std::endl;
+
+    nStatus = systemStore.ListUsers(1, 1, true, users);
+    if ( nStatus != OK || users.size() != 1 )
+        std::cout << "Failed to list users with restriction, error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "  " << users[0].Id << " " << users[0].name << ", restriction is TEST_RESTRICTION: "
+                  << ( users[0].restriction == TEST_RESTRICTION ? "yes" : "no" ) << std::endl;
+
+    nStatus = systemStore.ListUsers(0, 0, false, users);
+    if ( nStatus != OK )
+        std::cout << "Failed to list an empty page, error message: " << systemStore.GetErrMsg() << std::endl;
+
+    //Page through everything, then stream everything.
+    size_t nPaged = 0, nPages = 0;
+    __int64 lastId = 0;
+    bool ordered = true;
+    for ( ;; )
+    {
+        nStatus = systemStore.ListUsers(lastId, 1000, false, users);
+        if ( nStatus != OK || users.empty() )
+            break;
+        for ( auto const &user : users )
+        {
+            ordered = ordered && user.Id > lastId;
+            lastId = user.Id;
+        }
+        nPaged += users.size();
+        ++ nPages;
+    }
+    if ( nStatus != OK )
+        std::cout << "Failed to list users, error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to list " << nPaged << " users in " << nPages << " pages, in Id order: " << ( ordered ? "yes" : "no" ) << std::endl;
+
+    size_t nStreamed = 0;
+    nStatus = systemStore.ForEachUser(false, [&](const UserInfo &)
+    {
+        ++ nStreamed;
+        return true;
+    });
+    if ( nStatus != OK )
+        std::cout << "Failed to visit users, error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to visit " << nStreamed << " users, same as listed: " << ( nStreamed == nPaged ? "yes" : "no" ) << std::endl;
+
+    //The callback may use the store, and stops the visit.
+    AOI::String names;
+    nStatus = systemStore.ForEachUser(false, [&](const UserInfo &user)
+    {
+        UserRole role;
+        AOI::String restriction;
+        if ( systemStore.GetUserRoleAndRestriction(user.Id, role, restriction) == OK && role == user.role )
+            names += user.name + " ";
+        return user.name != "Developer";
+    });
+    if ( nStatus != OK )
+        std::cout << "Failed to visit users, error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to visit users up to \"Developer\": " << names << std::endl;
+}
+
+static void PrintAllowed(SystemStore &systemStore, __int64 Id, const char *key)
+{
+    bool allowed = false;
+    int nStatus = systemStore.IsAllowed(Id, systemStore.GetRestrictionKey(key), allowed);
+    if ( nStatus != OK )
+        std::cout << "Failed to check \"" << key << "\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "\"" << key << "\" allowed: " << ( allowed ? "yes" : "no" ) << std::endl;
+}
+
+static void TestRestriction()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "USER TABLE RESTRICTION TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    SystemStore systemStore;
+    __int64 Id = 0;
+    int nStatus = systemStore.UserLogin("Engineer1", "Engineer1", Id);
+    if ( nStatus != OK )
+        std::cout << "Failed to log in, error message: " << systemStore.GetErrMsg() << std::endl;
+
+    //An empty restriction allows nothing.
+    PrintAllowed(systemStore, Id, "Auto");
+
+    //A value overrides the default, comments are skipped.
+    const AOI::String restriction =
+"<?xml version=\"1.0\"?>\n\
+<restrictions version=\"1.0.0.0\">\n\
+    <!-- <restriction key=\"Commented\" value=\"true\" /> -->\n\
+    <restriction key=\"Auto\" default=\"true\" value=\"true\" />\n\
+    <restriction key=\"Auto_Stop\" default=\"true\" value=\"false\" />\n\
+    <restriction key='Config' default='TRUE' />\n\
+    <restriction key=\"Calib &amp; Align\" value=\"true\"></restriction>\n\
+</restrictions>";
+    nStatus = systemStore.UpdateUserRestriction(Id, restriction);
+    if ( nStatus != OK )
+        std::cout << "Failed to update restriction, error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Success to update restriction" << std::endl;
+
+    for ( const char *key : { "Auto", "Auto_Stop", "Config", "Calib & Align", "Commented", "NeverNamed" } )
+        PrintAllowed(systemStore, Id, key);
+
+    //The compiled restriction follows the update.
+    nStatus = systemStore.UpdateUserRestriction(Id, "<restrictions><restriction key=\"Auto_Stop\" value=\"true\"/></restrictions>");
+    if ( nStatus != OK )
+        std::cout << "Failed to update restriction, error message: " << systemStore.GetErrMsg() << std::endl;
+    PrintAllowed(systemStore, Id, "Auto");
+    PrintAllowed(systemStore, Id, "Auto_Stop");
+
+    //Malformed documents, the root element and CDATA name no keys.
+    const char *const malformed[] =
+    {
+        "<restrictions><restriction key=\"Auto\" value=\"true/></restrictions>",
+        "<restrictions><restriction key=\"Auto\" value=\"true\"/>",
+        "<restrictions key=\"Auto\" value=\"true\"></restrictions>",
+        "<restrictions><![CDATA[<restriction key=\"Auto\" value=\"true\"/>]]></restrictions>",
+    };
+    for ( const char *document : malformed )
+    {
+        nStatus = systemStore.UpdateUserRestriction(Id, document);
+        if ( nStatus != OK )
+            std::cout << "Failed to update restriction, error message: " << systemStore.GetErrMsg() << std::endl;
+        PrintAllowed(systemStore, Id, "Auto");
+    }
+
+    //Handles are per key, not per user.
+    std::cout << "Same handle for the same key: "
+              << ( systemStore.GetRestrictionKey("Auto") == systemStore.GetRestrictionKey("Auto") ? "yes" : "no" ) << std::endl;
+
+    bool allowed = false;
+    nStatus = systemStore.IsAllowed(Id + 1000, systemStore.GetRestrictionKey("Auto"), allowed);
+    if ( nStatus != OK )
+        std::cout << "Failed to check an unknown user, error message: " << systemStore.GetErrMsg() << std::endl;
+
+    nStatus = systemStore.UpdateUserRestriction(Id + 1000, restriction);
+    if ( nStatus != OK )
+        std::cout << "Failed to update restriction of an unknown user, error message: " << systemStore.GetErrMsg() << std::endl;
+}
+
+static __int64 CountProfiles()
+{
+    SQLite::Database db(SystemStore::GetDatabaseName(), SQLite::OPEN_READONLY);
+    return db.execAndGet("select count(*) from restriction_profile;").getInt64();
+}
+
+static void PrintRestriction(SystemStore &systemStore, const char *name)
+{
+    __int64 Id = 0;
+    UserRole role;
+    AOI::String restriction;
+    int nStatus = systemStore.UserLogin(name, name, Id);
+    if ( nStatus == OK )
+        nStatus = systemStore.GetUserRoleAndRestriction(Id, role, restriction);
+    if ( nStatus != OK )
+        std::cout << "Failed to get the restriction of \"" << name << "\", error message: " << systemStore.GetErrMsg() << std::endl;
+    else
+        std::cout << "Restriction of \"" << name << "\": " << restriction << std::endl;
+}
+
+static void TestRestrictionProfile()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "USER TABLE RESTRICTION PROFILE TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    SystemStore systemStore;
+    const AOI::String shared  = "<restrictions><restriction key=\"Shared\" value=\"true\"/></restrictions>";
+    const AOI::String changed = "<restrictions><restriction key=\"Changed\" value=\"true\"/></restrictions>";
+    const __int64 nProfiles = CountProfiles();
+
+    //Users with the same restriction share one profile.
+    for ( const char *name : { "Profile_A", "Profile_B", "Profile_C" } )
+    {
+        int nStatus = systemStore.AddUser(name, name, UserRole::OPERATOR, shared);
+        if ( nStatus != OK )
+            std::cout << "Failed to add user \"" << name << "\", error message: " << systemStore.GetErrMsg() << std::endl;
+    }
+    std::cout << "New profiles after adding 3 users: " << CountProfiles() - nProfiles << std::endl;
+
+    //Changing one user's restriction leaves the others alone.
+    __int64 Id = 0;
+    systemStore.UserLogin("Profile_A", "Profile_A", Id);
+    int nStatus = systemStore.UpdateUserRestriction(Id, changed);
+    if ( nStatus != OK )
+        std::cout << "Failed to update restriction, error message: " << systemStore.GetErrMsg() << std::endl;
+    std::cout << "New profiles after changing 1 user: " << CountProfiles() - nProfiles << std::endl;
+    PrintRestriction(systemStore, "Profile_A");
+    PrintRestriction(systemStore, "Profile_B");
+
+    //The shared profile goes once no user has it.
+    for ( const char *name : { "Profile_B", "Profile_C" } )
+    {
+        systemStore.UserLogin(name, name, Id);
+        systemStore.UpdateUserRestriction(Id, changed);
+    }
+    std::cout << "New profiles after changing all users: " << CountProfiles() - nProfiles << std::endl;
+    PrintRestriction(systemStore, "Profile_C");
+
+    //A rejected user leaves no profile behind.
+    nStatus = systemStore.AddUser("Profile_A", "Profile_A", UserRole::OPERATOR, "<restrictions/>");
+    if ( nStatus != OK )
+        std::cout << "Failed to add user \"Profile_A\" again, error message: " << systemStore.GetErrMsg() << std::endl;
+    std::cout << "New profiles after a rejected user: " << CountProfiles() - nProfiles << std::endl;
+
+    //So does an import whose users of a new restriction are all rejected.
+    UserImportVector users;
+    for ( const char *name : { "Profile_A", "Profile_B" } )
+    {
+        UserImport user = { name, name, UserRole::OPERATOR, "<restrictions><restriction key=\"Rejected\" value=\"true\"/></restrictions>" };
+        users.push_back(user);
+    }
+    StringVector errors;
+    nStatus = systemStore.ImportUsers(users, errors);
+    if ( nStatus != OK )
+        std::cout << "Failed to import users again, error message: " << systemStore.GetErrMsg() << std::endl;
+    std::cout << "New profiles after a rejected import: " << CountProfiles() - nProfiles << std::endl;
+}
+
+static void TestMigrateUsers()
+{
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl << "USER TABLE MIGRATE TEST #1 STARTING";
+    std::cout << std::endl << "------------------------------------------";
+    std::cout << std::endl;
+
+    //Create the user table with the old layout, which kept the restriction in each row.
+    {
+        SQLite::Database db(SystemStore::GetDatabaseName(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+        db.exec("drop table if exists users;");
+        db.exec("drop table if exists restriction_profile;");
+        db.exec("create table users(id integer primary key asc autoincrement, name text unique not null, password text not null, role integer not null, restriction text not null);");
+        db.exec("insert into users (id, name, password, role, restriction) values "
+                "(3, 'Legacy_A', '', 1, '<restrictions/>'), (7, 'Legacy_B', '', 2, '<restrictions/>'), (9, 'Legacy_C', '', 1, '');");
+    }
+
+    //The store is closed before its tables are dropped from another connection.
+    {
+        SystemStore systemStore;
+        UserInfoVector users;
+        int nStatus = systemStore.ListUsers(0, 10, true, users);
+        if ( nStatus != OK )
+            std::cout << "Failed to list users, error message: " << systemStore.GetErrMsg() << std::endl;
+        for ( const UserInfo &user : users )
+            std::cout << "  " << user.Id << " " << user.name << " " << static_cast<int>(user.role) << " \"" << user.restriction << "\"" << std::endl;
+        std::cout << "Profiles after migration: " << CountProfiles() << std::endl;
+
+        nStatus = systemStore.AddUser("Legacy_D", "Legacy_D", UserRole::OPERATOR, "<restrictions/>");
+        if ( nStatus != OK )
+            std::cout << "Failed to add user after migration, error message: " << systemStore.GetErrMsg() << std::endl;
+        std::cout << "Profiles after adding a user: " << CountProfiles() << std::endl;
+        PrintRestriction(systemStore, "Legacy_D");
+    }
+
+    //So the tests below start without users.
+    SQLite::Database db(SystemStore::GetDatabaseName(), SQLite::OPEN_READWRITE);
+    db.exec("drop table users;");
+    db.exec("drop table restriction_profile;");
 }
 
 void TestUserTable()
@@ -158,7 +615,13 @@ void TestUserTable()
         return;
     }
 
+    TestMigrateUsers();
     TestCreateUser();
     TestLogin();
     TestUpdatePassword();
+    TestSession();
+    TestRestriction();
+    TestImportUsers();
+    TestListUsers();
+    TestRestrictionProfile();
 }
\ No newline at end of file
@@ -2,9 +2,16 @@
 //
 
 #include "stdafx.h"
+#include <SQLiteCpp/SQLiteCpp.h>
 #include "..\SystemStore\SystemStore.h"
+#include "..\SystemStore\Rijndael.h"
 #include "Common\BaseDefs.h"
 #include <iostream>
+#include <chrono>
+#include <thread>
+#include <random>
+#include <algorithm>
+#include <cmath>
 
 using namespace AOI::SystemStore;
 
@@ -84,6 +91,398 @@ void TestParamTable()
         std::cout << "Success get float param, value: " << dValue << std::endl;
 }
 
+static double ElapsedMs(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static void ReadAllParams(SystemStore &systemStore, const StringVector &vecNames)
+{
+    int nValue = 0;
+    for ( const auto &name : vecNames )
+        if ( systemStore.GetParam(name, nValue) != OK )
+            std::cout << "Failed to get param, error message: " << systemStore.GetErrMsg() << std::endl;
+}
+
+//Compares opening the store and reading every param once, with and without
+//preloading, then the cost of a cached read.
+void BenchmarkParamPreload(int nCount)
+{
+    Int32ParamVector vecParams;
+    StringVector vecNames;
+    for ( int i = 0; i < nCount; ++ i )
+    {
+        vecNames.push_back("Bench." + std::to_string(nCount) + ".Station." + std::to_string(i));
+        vecParams.emplace_back(vecNames.back(), i);
+    }
+    std::shuffle(vecNames.begin(), vecNames.end(), std::mt19937(nCount));
+    {
+        SystemStore systemStore;
+        if ( systemStore.SetParams(vecParams) != OK )
+            std::cout << "Failed to set params, error message: " << systemStore.GetErrMsg() << std::endl;
+    }
+
+    std::cout << nCount << " params:" << std::endl;
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        SystemStore systemStore;
+        ReadAllParams(systemStore, vecNames);
+        std::cout << "  Lazy open and first read of all:    " << ElapsedMs(start) << " ms" << std::endl;
+    }
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        SystemStore systemStore(SystemStore::PRELOAD_PARAMS);
+        double dOpenMs = ElapsedMs(start);
+        ReadAllParams(systemStore, vecNames);
+        std::cout << "  Preload open:                       " << dOpenMs << " ms" << std::endl;
+        std::cout << "  Preload open and first read of all: " << ElapsedMs(start) << " ms" << std::endl;
+
+        start = std::chrono::high_resolution_clock::now();
+        ReadAllParams(systemStore, vecNames);
+        std::cout << "  Cached read:                        " << ElapsedMs(start) * 1e6 / nCount << " ns/param" << std::endl;
+    }
+}
+
+// Short prefix scans, whose statement comes from the statement cache.
+void BenchmarkStatementCache(int nCount)
+{
+    SystemStore systemStore;
+    Int32ParamVector params;
+    auto start = std::chrono::high_resolution_clock::now();
+    for ( int i = 0; i < nCount; ++ i )
+        if ( systemStore.GetParamsUnder("Bench.10000.Station.123", params) != OK )
+            std::cout << "Failed to get params, error message: " << systemStore.GetErrMsg() << std::endl;
+    std::cout << nCount << " scans of " << params.size() << " params: " << ElapsedMs(start) * 1000 / nCount << " us/scan" << std::endl;
+
+    __int64 nHits = 0, nMisses = 0, nEvictions = 0, nCompileUs = 0;
+    systemStore.GetStatementCacheStats(nHits, nMisses, nEvictions, nCompileUs);
+    std::cout << "  Statement cache: " << nHits << " hits, " << nMisses << " misses, " << nEvictions << " evictions, "
+              << nCompileUs << " us compiling" << std::endl;
+}
+
+//Reads a multi-megabyte binary param through each of the read APIs.
+void BenchmarkBinaryParam(size_t nBytes)
+{
+    const int nReads = 20;
+    SystemStore systemStore;
+    Binary vecBlob(nBytes, 0x5A);
+    bool bCreated = false;
+    if ( systemStore.SetParam("Bench.Blob", vecBlob, bCreated) != OK )
+        std::cout << "Failed to set param, error message: " << systemStore.GetErrMsg() << std::endl;
+
+    std::cout << nBytes / (1024 * 1024) << " MB binary param:" << std::endl;
+
+    Binary vecRead;
+    auto start = std::chrono::high_resolution_clock::now();
+    for ( int i = 0; i < nReads; ++ i )
+        systemStore.GetParam("Bench.Blob", vecRead);
+    std::cout << "  Into a reused vector:  " << ElapsedMs(start) / nReads << " ms/read" << std::endl;
+
+    size_t nSize = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for ( int i = 0; i < nReads; ++ i )
+        systemStore.GetParam("Bench.Blob", vecRead.data(), vecRead.size(), nSize);
+    std::cout << "  Into a caller buffer:  " << ElapsedMs(start) / nReads << " ms/read" << std::endl;
+
+    size_t nSum = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for ( int i = 0; i < nReads; ++ i )
+        systemStore.ViewParam("Bench.Blob", [&nSum](const void *data, size_t size) { nSum += static_cast<const unsigned char *>(data)[size - 1]; });
+    std::cout << "  Viewed in place:       " << ElapsedMs(start) / nReads << " ms/read" << std::endl;
+}
+
+//Times single updates, each its own transaction, and one batch of updates.
+void BenchmarkParamUpdate(int nCount)
+{
+    SystemStore systemStore;
+    Int32ParamVector vecParams;
+    for ( int i = 0; i < nCount; ++ i )
+        vecParams.emplace_back("Bench.Update." + std::to_string(i), i);
+    if ( systemStore.SetParams(vecParams) != OK )
+        std::cout << "Failed to set params, error message: " << systemStore.GetErrMsg() << std::endl;
+
+    std::cout << nCount << " param updates:" << std::endl;
+    auto start = std::chrono::high_resolution_clock::now();
+    for ( int i = 0; i < nCount; ++ i )
+        if ( systemStore.UpdateParam(vecParams[i].first, i + 1) != OK )
+            std::cout << "Failed to update param, error message: " << systemStore.GetErrMsg() << std::endl;
+    std::cout << "  UpdateParam: " << ElapsedMs(start) * 1000 / nCount << " us/param" << std::endl;
+
+    for ( auto &param : vecParams )
+        ++ param.second;
+    start = std::chrono::high_resolution_clock::now();
+    if ( systemStore.SetParams(vecParams) != OK )
+        std::cout << "Failed to set params, error message: " << systemStore.GetErrMsg() << std::endl;
+    std::cout << "  SetParams:   " << ElapsedMs(start) * 1000 / nCount << " us/param" << std::endl;
+}
+
+//Writes per second of separate calls, each its own transaction, and of the
+//same calls in one SystemStore::Batch.
+void BenchmarkBatch(int nCount)
+{
+    SystemStore systemStore;
+    std::cout << nCount << " params added and updated:" << std::endl;
+    for ( int batched = 0; batched < 2; ++ batched )
+    {
+        String prefix = batched ? "Bench.Batched." : "Bench.Unbatched.";
+        auto start = std::chrono::high_resolution_clock::now();
+        {
+            std::unique_ptr<SystemStore::Batch> pBatch;
+            if ( batched )
+                pBatch.reset(new SystemStore::Batch(systemStore));
+            for ( int i = 0; i < nCount; ++ i )
+            {
+                if ( systemStore.AddParam(prefix + std::to_string(i), i) != OK || systemStore.UpdateParam(prefix + std::to_string(i), i + 1) != OK )
+                    std::cout << "Failed to write param, error message: " << systemStore.GetErrMsg() << std::endl;
+            }
+            if ( pBatch && pBatch->Commit() != OK )
+                std::cout << "Failed to commit batch, error message: " << systemStore.GetErrMsg() << std::endl;
+        }
+        std::cout << ( batched ? "  In a batch: " : "  Unbatched:  " ) << 2 * nCount / ElapsedMs(start) * 1000 << " writes/s" << std::endl;
+    }
+}
+
+void BenchmarkSession(int nCount)
+{
+    SystemStore systemStore;
+    __int64 Id = 0;
+    String token;
+    std::cout << nCount << " re-authentications:" << std::endl;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for ( int i = 0; i < nCount; ++ i )
+        if ( systemStore.UserLogin("Engineer", "Yanliyuan1234$%", Id) != OK )
+            std::cout << "Failed to log in, error message: " << systemStore.GetErrMsg() << std::endl;
+    std::cout << "  UserLogin:       " << ElapsedMs(start) * 1000 / nCount << " us/call" << std::endl;
+
+    if ( systemStore.UserLogin("Engineer", "Yanliyuan1234$%", Id, token) != OK )
+        std::cout << "Failed to log in, error message: " << systemStore.GetErrMsg() << std::endl;
+    start = std::chrono::high_resolution_clock::now();
+    for ( int i = 0; i < nCount; ++ i )
+        if ( systemStore.ValidateSession(token, Id) != OK )
+            std::cout << "Failed to validate session, error message: " << systemStore.GetErrMsg() << std::endl;
+    std::cout << "  ValidateSession: " << ElapsedMs(start) * 1000 / nCount << " us/call" << std::endl;
+}
+
+// Password changes that succeed, each a committed write, against ones with
+// a wrong old password, which now fail without an exception.
+void BenchmarkUpdatePassword(int nCount)
+{
+    SystemStore systemStore;
+    systemStore.AddUser("PasswordBench", "PasswordBench_0", UserRole::OPERATOR, "");
+    std::cout << nCount << " password changes:" << std::endl;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for ( int i = 0; i < nCount; ++ i )
+        if ( systemStore.UpdatePassword("PasswordBench", "PasswordBench_" + std::to_string(i % 2), "PasswordBench_" + std::to_string(( i + 1 ) % 2)) != OK )
+            std::cout << "Failed to update password, error message: " << systemStore.GetErrMsg() << std::endl;
+    std::cout << "  Right old password: " << ElapsedMs(start) * 1000 / nCount << " us/call" << std::endl;
+
+    start = std::chrono::high_resolution_clock::now();
+    for ( int i = 0; i < nCount; ++ i )
+        systemStore.UpdatePassword("PasswordBench", "Wrong", "PasswordBench_0");
+    std::cout << "  Wrong old password: " << ElapsedMs(start) * 1000 / nCount << " us/call" << std::endl;
+}
+
+// Provisioning a line: one AddUser per account against one ImportUsers.
+void BenchmarkImportUsers(int nUsers)
+{
+    SystemStore systemStore;
+    std::cout << nUsers << " new users:" << std::endl;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for ( int i = 0; i < nUsers; ++ i )
+        if ( systemStore.AddUser("Added_" + std::to_string(i), "Operator", UserRole::OPERATOR, "") != OK )
+            std::cout << "Failed to add user, error message: " << systemStore.GetErrMsg() << std::endl;
+    std::cout << "  AddUser:     " << ElapsedMs(start) << " ms" << std::endl;
+
+    UserImportVector users;
+    for ( int i = 0; i < nUsers; ++ i )
+    {
+        UserImport user = { "Imported_" + std::to_string(i), "Operator", UserRole::OPERATOR, "" };
+        users.push_back(user);
+    }
+    StringVector errors;
+    start = std::chrono::high_resolution_clock::now();
+    if ( systemStore.ImportUsers(users, errors) != OK )
+        std::cout << "Failed to import users, error message: " << systemStore.GetErrMsg() << std::endl;
+    std::cout << "  ImportUsers: " << ElapsedMs(start) << " ms" << std::endl;
+}
+
+// Streams the whole user table, then reads a page at the start and one at
+// the end; with keyset pagination both cost the same.
+void BenchmarkListUsers(int nPageSize)
+{
+    SystemStore systemStore;
+    for ( bool withRestriction : { false, true } )
+    {
+        size_t nUsers = 0;
+        __int64 lastId = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        if ( systemStore.ForEachUser(withRestriction, [&](const UserInfo &user) { ++ nUsers; lastId = user.Id; return true; }) != OK )
+            std::cout << "Failed to visit users, error message: " << systemStore.GetErrMsg() << std::endl;
+        std::cout << "ForEachUser over " << nUsers << " users" << ( withRestriction ? " with restriction: " : ": " )
+                  << ElapsedMs(start) << " ms" << std::endl;
+
+        UserInfoVector users;
+        for ( __int64 afterId : { static_cast<__int64>(0), lastId - nPageSize } )
+        {
+            start = std::chrono::high_resolution_clock::now();
+            if ( systemStore.ListUsers(afterId, nPageSize, withRestriction, users) != OK )
+                std::cout << "Failed to list users, error message: " << systemStore.GetErrMsg() << std::endl;
+            std::cout << "  Page of " << users.size() << " after Id " << afterId << ": " << ElapsedMs(start) << " ms" << std::endl;
+        }
+    }
+}
+
+// A menu check the way the UI did it, fetching and scanning the XML,
+// against the compiled restriction.
+void BenchmarkRestriction(int nKeys, int nCount)
+{
+    SystemStore systemStore;
+    __int64 Id = 0;
+    if ( systemStore.UserLogin("Engineer", "Yanliyuan1234$%", Id) != OK )
+        std::cout << "Failed to log in, error message: " << systemStore.GetErrMsg() << std::endl;
+
+    String restriction = "<?xml version=\"1.0\"?>\n<restrictions version=\"1.0.0.0\">\n";
+    for ( int i = 0; i < nKeys; ++ i )
+        restriction += "    <restriction key=\"Menu_" + std::to_string(i) + "\" default=\"true\" value=\"" + ( i % 3 ? "true" : "false" ) + "\" />\n";
+    restriction += "</restrictions>";
+    if ( systemStore.UpdateUserRestriction(Id, restriction) != OK )
+        std::cout << "Failed to update restriction, error message: " << systemStore.GetErrMsg() << std::endl;
+
+    const String key = "Menu_" + std::to_string(nKeys - 1);
+    std::cout << nCount << " checks of the last of " << nKeys << " keys:" << std::endl;
+
+    UserRole role;
+    int nAllowed = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for ( int i = 0; i < nCount; ++ i )
+    {
+        if ( systemStore.GetUserRoleAndRestriction(Id, role, restriction) != OK )
+            std::cout << "Failed to get role and restriction, error message: " << systemStore.GetErrMsg() << std::endl;
+        size_t pos = restriction.find("key=\"" + key + "\"");
+        nAllowed += pos != String::npos && restriction.compare(restriction.find("value=\"", pos) + 7, 4, "true") == 0;
+    }
+    std::cout << "  Fetch and scan XML: " << ElapsedMs(start) * 1000 / nCount << " us/check" << std::endl;
+
+    Int32 keyHandle = systemStore.GetRestrictionKey(key);
+    bool allowed = false;
+    start = std::chrono::high_resolution_clock::now();
+    for ( int i = 0; i < nCount; ++ i )
+    {
+        if ( systemStore.IsAllowed(Id, keyHandle, allowed) != OK )
+            std::cout << "Failed to check restriction, error message: " << systemStore.GetErrMsg() << std::endl;
+        nAllowed -= allowed;
+    }
+    std::cout << "  IsAllowed:          " << ElapsedMs(start) * 1000 / nCount << " us/check"
+              << ( nAllowed == 0 ? "" : ", DIFFERENT results" ) << std::endl;
+}
+
+void BenchmarkCipher(int nBlocks)
+{
+    const char *pathNames[] = { "Table", "SSSE3", "AES-NI" };
+    CRijndael rijndael;
+    rijndael.MakeKey("ABCDEFGH12346789", CRijndael::sm_chain0, 16, 16);
+    std::vector<char> vecData(nBlocks * 16, 0x5A);
+
+    std::cout << nBlocks << " 128-bit blocks:" << std::endl;
+    for ( int path = CRijndael::PATH_TABLE; path <= CRijndael::PATH_AESNI; ++ path )
+    {
+        if ( ! CRijndael::IsPathSupported(path) )
+            continue;
+
+        rijndael.SetPath(path);
+        auto start = std::chrono::high_resolution_clock::now();
+        for ( int i = 0; i < nBlocks; ++ i )
+            rijndael.EncryptBlock(&vecData[i * 16], &vecData[i * 16]);
+        double dMs = ElapsedMs(start);
+        std::cout << "  " << pathNames[path] << ": " << dMs * 1e6 / nBlocks << " ns/block, "
+                  << nBlocks * 16 / dMs / 1e3 << " MB/s" << std::endl;
+    }
+}
+
+// CTR over one buffer (split across threads) and streamed in 64 KB chunks,
+// against serial CBC, on every block path.
+void BenchmarkCtr(size_t nBytes)
+{
+    const char *pathNames[] = { "Table", "SSSE3", "AES-NI" };
+    const size_t nChunk = 64 * 1024;
+    CRijndael rijndael;
+    rijndael.MakeKey("ABCDEFGH12346789", CRijndael::sm_chain0, 16, 16);
+    std::vector<char> vecIn(nBytes, 0x5A), vecOut(nBytes);
+
+    std::cout << nBytes / (1024 * 1024) << " MB bulk encryption, " << std::thread::hardware_concurrency() << " hardware threads:" << std::endl;
+    for ( int path = CRijndael::PATH_TABLE; path <= CRijndael::PATH_AESNI; ++ path )
+    {
+        if ( ! CRijndael::IsPathSupported(path) )
+            continue;
+
+        rijndael.SetPath(path);
+        rijndael.ResetChain();
+        auto start = std::chrono::high_resolution_clock::now();
+        rijndael.Encrypt(vecIn.data(), vecOut.data(), nBytes, CRijndael::CBC);
+        double dCbc = nBytes / ElapsedMs(start) / 1e6;
+
+        rijndael.ResetChain();
+        start = std::chrono::high_resolution_clock::now();
+        rijndael.Encrypt(vecIn.data(), vecOut.data(), nBytes, CRijndael::CTR);
+        double dCtr = nBytes / ElapsedMs(start) / 1e6;
+
+        rijndael.ResetChain();
+        start = std::chrono::high_resolution_clock::now();
+        for ( size_t offset = 0; offset < nBytes; offset += nChunk )
+            rijndael.Encrypt(&vecIn[offset], &vecOut[offset], std::min(nChunk, nBytes - offset), CRijndael::CTR);
+        double dStream = nBytes / ElapsedMs(start) / 1e6;
+
+        std::cout << "  " << pathNames[path] << ": CBC " << dCbc << " GB/s, CTR " << dCtr << " GB/s, CTR streamed " << dStream << " GB/s" << std::endl;
+    }
+}
+
+// A height map of nWidth x nHeight floats: a smooth surface with sensor noise
+// in the low mantissa bits. Compared with the same array as a binary param.
+void BenchmarkCalibration(int nWidth, int nHeight)
+{
+    const int nLoads = 10;
+    SystemStore systemStore;
+    FloatVector vecMap(static_cast<size_t>(nWidth) * nHeight);
+    std::mt19937 generator(1);
+    std::normal_distribution<float> noise(0.f, 0.001f);
+    for ( int y = 0; y < nHeight; ++ y )
+        for ( int x = 0; x < nWidth; ++ x )
+            vecMap[static_cast<size_t>(y) * nWidth + x] = 0.5f * std::sin(x * 0.002f) * std::cos(y * 0.003f) + noise(generator);
+
+    const size_t nRawBytes = vecMap.size() * sizeof(float);
+    std::cout << nWidth << " x " << nHeight << " float calibration (" << nRawBytes / (1024 * 1024) << " MB raw):" << std::endl;
+
+    Binary vecRaw(reinterpret_cast<const unsigned char *>(vecMap.data()), reinterpret_cast<const unsigned char *>(vecMap.data()) + nRawBytes);
+    bool bCreated = false;
+    if ( systemStore.SetParam("Bench.Calibration", vecRaw, bCreated) != OK )
+        std::cout << "Failed to set param, error message: " << systemStore.GetErrMsg() << std::endl;
+
+    __int64 version = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    if ( systemStore.SaveCalibration("Bench.Calibration", vecMap, version) != OK )
+        std::cout << "Failed to save calibration, error message: " << systemStore.GetErrMsg() << std::endl;
+    std::cout << "  SaveCalibration:        " << ElapsedMs(start) << " ms" << std::endl;
+
+    SQLite::Database db(SystemStore::GetDatabaseName(), SQLite::OPEN_READONLY);
+    __int64 nStoredBytes = db.execAndGet("select length(data) from calibration where name = 'Bench.Calibration';").getInt64();
+    std::cout << "  Stored size:            " << 100.0 * nStoredBytes / nRawBytes << " % of raw" << std::endl;
+
+    FloatVector vecLoaded(vecMap.size());
+    size_t nSize = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for ( int i = 0; i < nLoads; ++ i )
+        systemStore.GetParam("Bench.Calibration", vecLoaded.data(), nRawBytes, nSize);
+    std::cout << "  Raw binary param:       " << ElapsedMs(start) / nLoads << " ms/load" << std::endl;
+
+    start = std::chrono::high_resolution_clock::now();
+    for ( int i = 0; i < nLoads; ++ i )
+        systemStore.LoadCalibration("Bench.Calibration", vecLoaded, version);
+    std::cout << "  LoadCalibration:        " << ElapsedMs(start) / nLoads << " ms/load" << std::endl;
+}
+
 int _tmain(int argc, _TCHAR* argv[])
 {
     if ( AOI::FileUtils::Exists(SystemStore::GetDatabaseName()))
@@ -91,6 +490,20 @@ int _tmain(int argc, _TCHAR* argv[])
 
     TestUserTable();
     TestParamTable();
+    BenchmarkParamPreload(10000);
+    BenchmarkParamPreload(100000);
+    BenchmarkStatementCache(10000);
+    BenchmarkBinaryParam(8 * 1024 * 1024);
+    BenchmarkParamUpdate(2000);
+    BenchmarkBatch(1000);
+    BenchmarkCalibration(2048, 2048);
+    BenchmarkSession(10000);
+    BenchmarkUpdatePassword(200);
+    BenchmarkImportUsers(500);
+    BenchmarkListUsers(100);
+    BenchmarkRestriction(200, 10000);
+    BenchmarkCipher(1000000);
+    BenchmarkCtr(64 * 1024 * 1024);
 	return 0;
 }
 